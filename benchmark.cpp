@@ -0,0 +1,324 @@
+// renders canned scenes along fixed camera paths in every raster and shading mode
+// and reports min / median / p99 of every frame stage as json, to catch regressions and compare the modes
+#include "objLoader.h"
+#include "plotter.h"
+#include "simd.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <numbers>
+#include <vector>
+
+namespace {
+
+struct Scene {
+    QString name;
+    QString source;     // file the mesh was loaded from, or generated
+    Mesh mesh;
+    // camera path: lookAt the origin from an orbit, turns over all measured frames
+    float radius = 3.f;
+    float height = 1.f;
+    float turns = 1.f;
+};
+
+// corners a, b, c, d counter clockwise seen from the front, one normal for the face
+void addQuad(Mesh &mesh, int a, int b, int c, int d, const Math::Vec3 &normal)
+{
+    const int n = mesh.normals.size();
+    mesh.normals.append(normal);
+    const int uv[4] = {0, 1, 2, 3};
+    const int corners[4] = {a, b, c, d};
+    for (int k = 0; k < 4; ++k) {
+        mesh.addCorner(corners[k], n, uv[k]);
+    }
+    mesh.endFace();
+}
+
+// uvs of the unit square for quads, every scene has one texture
+void addUnitUvs(Mesh &mesh)
+{
+    for (const Math::Vec3 &uv : {Math::Vec3{0, 0, 0}, Math::Vec3{1, 0, 0}, Math::Vec3{1, 1, 0}, Math::Vec3{0, 1, 0}}) {
+        mesh.uvs.append(uv);
+        mesh.uvTexIds.append(0);
+    }
+}
+
+Mesh cube()
+{
+    Mesh mesh;
+    for (int i = 0; i < 8; ++i) {
+        mesh.positions.append({i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f, i & 4 ? 1.f : -1.f});
+        mesh.colors.append({0.3f + 0.7f * (i & 1), 0.3f + 0.35f * (i >> 1 & 1), 0.3f + 0.7f * (i >> 2 & 1)});
+    }
+    addUnitUvs(mesh);
+    addQuad(mesh, 4, 5, 7, 6, {0, 0, 1});
+    addQuad(mesh, 1, 0, 2, 3, {0, 0, -1});
+    addQuad(mesh, 5, 1, 3, 7, {1, 0, 0});
+    addQuad(mesh, 0, 4, 6, 2, {-1, 0, 0});
+    addQuad(mesh, 6, 7, 3, 2, {0, 1, 0});
+    addQuad(mesh, 0, 1, 5, 4, {0, -1, 0});
+    mesh.textures.append(TexInfo{{}, {}, {}, {}, {1, 1, 1}});
+    return mesh;
+}
+
+// uv sphere of radius 2, rings * segments quads, 2 triangles each
+Mesh sphere(int rings, int segments, bool textured)
+{
+    Mesh mesh;
+    mesh.positions.reserve((rings + 1) * (segments + 1));
+    mesh.normals.reserve((rings + 1) * (segments + 1));
+    for (int i = 0; i <= rings; ++i) {
+        for (int j = 0; j <= segments; ++j) {
+            const float theta = std::numbers::pi_v<float> * i / rings, phi = 2 * std::numbers::pi_v<float> * j / segments;
+            const Math::Vec3 p{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            mesh.positions.append(p * 2);
+            mesh.normals.append(p);
+            mesh.uvs.append({float(j) / segments, 1 - float(i) / rings, 0});
+            mesh.uvTexIds.append(0);
+        }
+    }
+    mesh.colors.fill({1, 1, 1}, mesh.positions.size());
+    for (int i = 0; i < rings; ++i) {
+        for (int j = 0; j < segments; ++j) {
+            const int a = i * (segments + 1) + j, b = a + 1, c = a + segments + 1, d = c + 1;
+            for (const int k : {a, b, d, c}) {
+                mesh.addCorner(k, k, k);
+            }
+            mesh.endFace();
+        }
+    }
+    TexInfo tex{{}, {}, {}, {}, {1, 1, 1}};
+    if (textured) {
+        // checker diffuse and a glowing band, so the texture and bloom paths are part of the frame
+        QImage diffuse(512, 512, QImage::Format_RGB32), glow(64, 64, QImage::Format_RGB32);
+        for (int y = 0; y < diffuse.height(); ++y) {
+            for (int x = 0; x < diffuse.width(); ++x) {
+                diffuse.setPixel(x, y, (x / 32 + y / 32) & 1 ? qRgb(220, 200, 180) : qRgb(60, x / 2, y / 2));
+            }
+        }
+        glow.fill(Qt::black);
+        for (int y = 28; y < 36; ++y) {
+            for (int x = 0; x < glow.width(); ++x) {
+                glow.setPixel(x, y, qRgb(255, 128, 0));
+            }
+        }
+        tex.tDiffuse = diffuse;
+        tex.tBloom = glow;
+    }
+    mesh.textures.append(tex);
+    return mesh;
+}
+
+// layers full screen quads one behind the other, drawn back to front: every pixel is written layers times
+Mesh overdraw(int layers)
+{
+    Mesh mesh;
+    addUnitUvs(mesh);
+    const Math::Vec3 normal{0, 0, 1};
+    for (int layer = 0; layer < layers; ++layer) {
+        const float z = -2.f + 4.f * layer / (layers - 1);
+        const int first = mesh.positions.size();
+        for (const Math::Vec3 &corner : {Math::Vec3{-5, -5, z}, Math::Vec3{5, -5, z}, Math::Vec3{5, 5, z}, Math::Vec3{-5, 5, z}}) {
+            mesh.positions.append(corner);
+            mesh.colors.append({float(layer) / layers, 0.5f, 1.f - float(layer) / layers});
+        }
+        addQuad(mesh, first, first + 1, first + 2, first + 3, normal);
+    }
+    mesh.textures.append(TexInfo{{}, {}, {}, {}, {1, 1, 1}});
+    return mesh;
+}
+
+// the textured model of the app if it is there, a generated mesh of the same kind otherwise
+Scene textured()
+{
+    Scene scene{"textured"};
+    const QString path = "./Models/Cyber Mancubus/mancubus.obj";
+    if (loadOBJ(QFile(path), scene.mesh)) {
+        scene.source = path;
+        if (scene.mesh.colors.isEmpty()) {
+            scene.mesh.colors.fill(Math::Vec3{1, 1, 1}, scene.mesh.positions.size());
+        }
+        scene.radius = 2.f;
+        scene.height = 0.5f;
+    } else {
+        scene.source = "generated";
+        scene.mesh = sphere(128, 256, true);
+    }
+    return scene;
+}
+
+qsizetype triangleCount(const Mesh &mesh)
+{
+    qsizetype n = 0;
+    for (qsizetype f = 0; f < mesh.faceCount(); ++f) {
+        n += mesh.faceOffsets[f + 1] - mesh.faceOffsets[f] - 2;
+    }
+    return n;
+}
+
+// nearest rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p)
+{
+    const size_t rank = size_t(std::ceil(p / 100 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+QJsonObject stats(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return {
+        {"min", values.front()},
+        {"median", percentile(values, 50)},
+        {"p99", percentile(values, 99)},
+        {"max", values.back()},
+    };
+}
+
+// the same order and names as Plotter::FrameTimings
+const std::vector<std::pair<QString, double Plotter::FrameTimings::*>> stages{
+    {"setup", &Plotter::FrameTimings::setup},
+    {"vertex", &Plotter::FrameTimings::vertex},
+    {"geometry", &Plotter::FrameTimings::geometry},
+    {"raster", &Plotter::FrameTimings::raster},
+    {"bloom", &Plotter::FrameTimings::bloom},
+    {"resolve", &Plotter::FrameTimings::resolve},
+    {"total", &Plotter::FrameTimings::total},
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // no gui application, the scheduler timer only needs an event dispatcher
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders fixed scenes along fixed camera paths and reports stage timings as json.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"scenes", "Comma separated: cube, textured, dense, overdraw.", "list", "cube,textured,dense,overdraw"},
+        {"raster", "scanline, halfspace or all.", "mode", "all"},
+        {"shading", "deferred, forward or all.", "mode", "all"},
+        {{"n", "frames"}, "Measured frames of every run.", "n", "60"},
+        {"warmup", "Frames rendered before measuring.", "n", "5"},
+        {{"s", "size"}, "Output size.", "WxH", "1440x960"},
+        {"half", "Half precision hdr planes."},
+        {{"o", "output"}, "Json file, stdout if not set.", "file"},
+    });
+    parser.process(app);
+
+    const QStringList wh = parser.value("size").split('x');
+    const QSize size = wh.size() == 2 ? QSize(wh[0].toInt(), wh[1].toInt()) : QSize();
+    const int count = parser.value("frames").toInt(), warmup = parser.value("warmup").toInt();
+    if (size.isEmpty() || count <= 0 || warmup < 0) {
+        std::fprintf(stderr, "bad size or frame count\n");
+        return 1;
+    }
+
+    // scenes are built when their turn comes, the dense one alone is a million triangles
+    const std::vector<std::pair<QString, std::function<Scene()>>> generators{
+        {"cube", [] { return Scene{"cube", "generated", cube(), 2.f, 1.f, 1.f}; }},
+        {"textured", textured},
+        {"dense", [] { return Scene{"dense", "generated", sphere(500, 1000, false)}; }},
+        // seen almost head on, the path sways to 45 degrees
+        {"overdraw", [] { return Scene{"overdraw", "generated", overdraw(64), 3.f, 0.f, 0.125f}; }},
+    };
+    const QStringList selected = parser.value("scenes").split(',');
+    std::vector<std::pair<QString, Plotter::RasterMode>> rasterModes;
+    for (const auto &mode : {std::pair{QString("scanline"), Plotter::RasterMode::Scanline},
+                             std::pair{QString("halfspace"), Plotter::RasterMode::HalfSpace}}) {
+        if (parser.value("raster") == "all" || parser.value("raster") == mode.first) rasterModes.push_back(mode);
+    }
+    std::vector<std::pair<QString, Plotter::ShadingMode>> shadingModes;
+    for (const auto &mode : {std::pair{QString("deferred"), Plotter::ShadingMode::Deferred},
+                             std::pair{QString("forward"), Plotter::ShadingMode::Forward}}) {
+        if (parser.value("shading") == "all" || parser.value("shading") == mode.first) shadingModes.push_back(mode);
+    }
+    if (rasterModes.empty() || shadingModes.empty()) {
+        std::fprintf(stderr, "unknown raster or shading mode\n");
+        return 1;
+    }
+
+    QJsonArray runs;
+    for (const auto &[name, generate] : generators) {
+        if (!selected.contains(name)) continue;
+        Scene scene = generate();
+        const qsizetype triangles = triangleCount(scene.mesh);
+        std::fprintf(stderr, "%s: %lld triangles (%s)\n", qPrintable(name), (long long)triangles, qPrintable(scene.source));
+
+        Plotter plotter(size);
+        // frames are rendered here one after another, not by the timer
+        plotter.getScheduler()->setPaused(true);
+        plotter.setData(std::move(scene.mesh));
+        plotter.setBufferFormat(parser.isSet("half") ? Plotter::BufferFormat::Float16 : Plotter::BufferFormat::Float32);
+        const auto pose = [&](int frame) {
+            const float angle = 2 * std::numbers::pi_v<float> * scene.turns * frame / count;
+            plotter.getCamera()->lookAt({scene.radius * std::sin(angle), scene.height, scene.radius * std::cos(angle)}, {0, 0, 0});
+        };
+
+        for (const auto &[rasterName, rasterMode] : rasterModes) {
+            for (const auto &[shadingName, shadingMode] : shadingModes) {
+                plotter.setRasterMode(rasterMode);
+                plotter.setShadingMode(shadingMode);
+                pose(0);
+                for (int i = 0; i < warmup; ++i) {
+                    plotter.plot();
+                }
+                std::vector<std::vector<double>> times(stages.size(), std::vector<double>(count));
+                for (int i = 0; i < count; ++i) {
+                    pose(i);
+                    plotter.plot();
+                    for (size_t s = 0; s < stages.size(); ++s) {
+                        times[s][i] = plotter.getTimings().*stages[s].second;
+                    }
+                }
+                QJsonObject stageStats;
+                for (size_t s = 0; s < stages.size(); ++s) {
+                    stageStats[stages[s].first] = stats(times[s]);
+                }
+                runs.append(QJsonObject{
+                    {"scene", name},
+                    {"source", scene.source},
+                    {"triangles", qint64(triangles)},
+                    {"raster", rasterName},
+                    {"shading", shadingName},
+                    {"stages", stageStats},
+                });
+                std::fprintf(stderr, "  %s %s: median %.3f ms\n", qPrintable(rasterName), qPrintable(shadingName),
+                             stageStats["total"].toObject()["median"].toDouble());
+            }
+        }
+    }
+
+    const QJsonObject report{
+        {"size", QJsonArray{size.width(), size.height()}},
+        {"frames", count},
+        {"warmup", warmup},
+        {"bufferFormat", parser.isSet("half") ? "float16" : "float32"},
+        {"threads", QThread::idealThreadCount()},
+        {"simdWidth", Simd::Float::width},
+        {"unit", "ms"},
+        {"runs", runs},
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet("output")) {
+        QFile file(parser.value("output"));
+        if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "can not write %s\n", qPrintable(parser.value("output")));
+            return 1;
+        }
+    } else {
+        std::fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include "bloom.h"
+#include "fast_gaussian_blur_template.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <numeric>
+
+namespace {
+
+constexpr int channels = 3;
+// blur of every small level, in its own pixels
+constexpr float levelSigma = 1.5f;
+// levels are not made smaller than this
+constexpr int minLevelSize = 4;
+
+template<typename F>
+void forRows(int h, F &&f)
+{
+    std::vector<int> rows(h);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::for_each(std::execution::par_unseq, rows.cbegin(), rows.cend(), f);
+}
+
+// 2x2 box filter, odd sizes repeat their last row or column, channels above threshold only,
+// src rows are spitch values apart
+template<typename S>
+void downsample(const S *src, int spitch, int sw, int sh, float *dst, int dw, int dh, float threshold)
+{
+    forRows(dh, [=](int y) {
+        const S *s0 = src + std::min(2 * y, sh - 1) * spitch;
+        const S *s1 = src + std::min(2 * y + 1, sh - 1) * spitch;
+        const float *r0, *r1;
+        if constexpr (std::is_same_v<S, Half>) {
+            // both rows to float at once with simd conversions
+            thread_local std::vector<float> rows;
+            rows.resize(2 * sw * channels);
+            Simd::convert(s0, rows.data(), sw * channels);
+            Simd::convert(s1, rows.data() + sw * channels, sw * channels);
+            r0 = rows.data();
+            r1 = rows.data() + sw * channels;
+        } else {
+            r0 = s0;
+            r1 = s1;
+        }
+        float *out = dst + y * dw * channels;
+        for (int x = 0; x < dw; ++x) {
+            const int x0 = std::min(2 * x, sw - 1) * channels, x1 = std::min(2 * x + 1, sw - 1) * channels;
+            for (int k = 0; k < channels; ++k) {
+                out[x * channels + k] = 0.25f * (std::max(r0[x0 + k] - threshold, 0.f) + std::max(r0[x1 + k] - threshold, 0.f) +
+                                                 std::max(r1[x0 + k] - threshold, 0.f) + std::max(r1[x1 + k] - threshold, 0.f));
+            }
+        }
+    });
+}
+
+// dst = (Add ? dst : 0) + bilinear upsampled src * scale,
+// src is the next level of dst, its pixels are twice as big even if dst has an odd size,
+// dst rows are dpitch values apart, half dst is only written, not added to
+template<bool Add, typename D>
+void upsample(const float *src, int sw, int sh, D *dst, int dpitch, int dw, int dh, float scale)
+{
+    // source columns and weights are the same for every row
+    std::vector<int> cx0(dw), cx1(dw);
+    std::vector<float> tx(dw);
+    for (int x = 0; x < dw; ++x) {
+        const float fx = std::clamp((x + 0.5f) * 0.5f - 0.5f, 0.f, float(sw - 1));
+        cx0[x] = int(fx);
+        cx1[x] = std::min(cx0[x] + 1, sw - 1);
+        tx[x] = fx - cx0[x];
+    }
+    forRows(dh, [&](int y) {
+        const float fy = std::clamp((y + 0.5f) * 0.5f - 0.5f, 0.f, float(sh - 1));
+        const int y0 = int(fy), y1 = std::min(y0 + 1, sh - 1);
+        const float ty = fy - y0;
+        const float *r0 = src + y0 * sw * channels, *r1 = src + y1 * sw * channels;
+        // half rows are made in float and converted at once
+        thread_local std::vector<float> row;
+        float *out;
+        if constexpr (std::is_same_v<D, Half>) {
+            row.resize(dw * channels);
+            out = row.data();
+        } else {
+            out = dst + y * dpitch;
+        }
+        for (int x = 0; x < dw; ++x) {
+            const int a = cx0[x] * channels, b = cx1[x] * channels;
+            for (int k = 0; k < channels; ++k) {
+                const float top = r0[a + k] + (r0[b + k] - r0[a + k]) * tx[x];
+                const float bottom = r1[a + k] + (r1[b + k] - r1[a + k]) * tx[x];
+                const float v = (top + (bottom - top) * ty) * scale;
+                if constexpr (Add) {
+                    out[x * channels + k] += v;
+                } else {
+                    out[x * channels + k] = v;
+                }
+            }
+        }
+        if constexpr (std::is_same_v<D, Half>) {
+            Simd::convert(out, dst + y * dpitch, dw * channels);
+        }
+    });
+}
+
+// blurs data in place, tmp is scratch of the same size
+void gaussian(float *data, float *tmp, int w, int h, float sigma)
+{
+    float *in = data, *out = tmp;
+    fast_gaussian_blur(in, out, w, h, channels, sigma, 3);
+    if (out != data) memcpy(data, out, sizeof(float) * w * h * channels);
+}
+
+} // namespace
+
+Bloom::Bloom(QSize size)
+    : size(size)
+    , capacity(size)
+{
+    buildLevels();
+}
+
+void Bloom::setSize(QSize size)
+{
+    Q_ASSERT(size.width() <= capacity.width() && size.height() <= capacity.height());
+    this->size = size;
+}
+
+void Bloom::setRadius(float radius)
+{
+    this->radius = std::max(radius, 1.f);
+    buildLevels();
+}
+
+void Bloom::buildLevels()
+{
+    // coarsest level blurred by levelSigma spans radius full resolution pixels
+    int count = std::max(1, (int)std::ceil(std::log2(radius / levelSigma)));
+    // the radius follows the render size, levels are only ever added so a smaller frame
+    // does not free buffers the next larger one allocates again
+    int w = capacity.width(), h = capacity.height(), built = 0;
+    for (; built < count; ++built) {
+        if (built > 0 && std::min(w, h) / 2 < minLevelSize) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        if (built < int(levels.size())) continue;
+        Level &level = levels.emplace_back();
+        level.w = w;
+        level.h = h;
+        level.data.resize(w * h * channels);
+        level.tmp.resize(w * h * channels);
+    }
+    activeLevels = built;
+}
+
+int Bloom::margin() const
+{
+    if (mode == Mode::Gaussian) return (int)std::ceil(3 * radius);
+    // 3 sigma of the coarsest level blur plus the down and up filters, in full resolution pixels
+    return (int)std::ceil((3 * levelSigma + 2) * (1 << activeLevels));
+}
+
+template<typename T>
+QRect Bloom::apply(T *image, float *tmp, const QRect &emissive)
+{
+    // no emission, nothing to blur and image is all zero
+    if (emissive.isEmpty()) return QRect();
+
+    // grow by the glow reach, pyramid levels keep the frame pixel grid when the region starts at a multiple of their scale
+    const int m = margin(), align = mode == Mode::Pyramid ? 1 << activeLevels : 1;
+    QRect r = emissive.adjusted(-m, -m, m, m).intersected(QRect(QPoint(0, 0), size));
+    r.setLeft(r.left() / align * align);
+    r.setTop(r.top() / align * align);
+
+    const int pitch = size.width() * channels;
+    T *origin = image + r.top() * pitch + r.left() * channels;
+    if (mode == Mode::Gaussian) {
+        applyGaussian(origin, pitch, tmp, r.width(), r.height());
+    } else {
+        applyPyramid(origin, pitch, r.width(), r.height());
+    }
+    return r;
+}
+
+template<typename T>
+void Bloom::applyGaussian(T *image, int pitch, float *tmp, int w, int h)
+{
+    // the blur runs on contiguous float, full width float regions are blurred in place
+    bool inPlace = false;
+    float *data = nullptr;
+    if constexpr (std::is_same_v<T, float>) {
+        inPlace = pitch == w * channels;
+        data = image;
+    }
+    if (!inPlace) {
+        region.resize(w * h * channels);
+        data = region.data();
+        forRows(h, [&](int y) {
+            if constexpr (std::is_same_v<T, Half>) {
+                Simd::convert(image + y * pitch, data + y * w * channels, w * channels);
+            } else {
+                std::copy(image + y * pitch, image + y * pitch + w * channels, data + y * w * channels);
+            }
+        });
+    }
+    if (threshold > 0.f) {
+        std::transform(std::execution::par_unseq, data, data + w * h * channels, data,
+                       [t = threshold](float c) { return std::max(c - t, 0.f); });
+    }
+    gaussian(data, tmp, w, h, radius);
+    if (!inPlace) {
+        forRows(h, [&](int y) {
+            if constexpr (std::is_same_v<T, Half>) {
+                Simd::convert(data + y * w * channels, image + y * pitch, w * channels);
+            } else {
+                std::copy(data + y * w * channels, data + (y + 1) * w * channels, image + y * pitch);
+            }
+        });
+    }
+}
+
+template<typename T>
+void Bloom::applyPyramid(T *image, int pitch, int w, int h)
+{
+    // down: frame -> 1/2 -> 1/4 ..., the frame region is read in place
+    levels[0].w = (w + 1) / 2;
+    levels[0].h = (h + 1) / 2;
+    downsample(image, pitch, w, h, levels[0].data.data(), levels[0].w, levels[0].h, threshold);
+    for (int i = 1; i < activeLevels; ++i) {
+        Level &level = levels[i], &bigger = levels[i - 1];
+        level.w = (bigger.w + 1) / 2;
+        level.h = (bigger.h + 1) / 2;
+        downsample(bigger.data.data(), bigger.w * channels, bigger.w, bigger.h, level.data.data(), level.w, level.h, 0.f);
+    }
+    // up: blur every level below 1/2 and add it to the next bigger one,
+    // the 1/2 level is smooth enough from the bilinear upsampling alone
+    for (int i = activeLevels - 1; i > 0; --i) {
+        Level &level = levels[i], &bigger = levels[i - 1];
+        gaussian(level.data.data(), level.tmp.data(), level.w, level.h, levelSigma);
+        upsample<true>(level.data.data(), level.w, level.h, bigger.data.data(), bigger.w * channels, bigger.w, bigger.h, 1.f);
+    }
+    if (activeLevels == 1) {
+        gaussian(levels[0].data.data(), levels[0].tmp.data(), levels[0].w, levels[0].h, levelSigma);
+    }
+    // every level added its share, average them
+    upsample<false>(levels[0].data.data(), levels[0].w, levels[0].h, image, pitch, w, h, 1.f / activeLevels);
+}
+
+// the emissive plane of the plotter is float or half
+template QRect Bloom::apply(float *image, float *tmp, const QRect &emissive);
+template QRect Bloom::apply(Half *image, float *tmp, const QRect &emissive);
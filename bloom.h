@@ -0,0 +1,75 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "half.h"
+
+#include <QRect>
+#include <QSize>
+
+#include <vector>
+
+// blurs the emissive rgb float plane of a frame
+class Bloom
+{
+public:
+    enum class Mode {
+        Gaussian,   // full resolution fast gaussian blur
+        Pyramid,    // threshold, downsample to 1/2, 1/4 ..., blur the small levels, upsample and accumulate
+    };
+
+public:
+    // buffers are allocated for size once, frames can be smaller
+    explicit Bloom(QSize size);
+
+public:
+    // size of the frames from now on, at most the one of the constructor
+    void setSize(QSize size);
+    QSize getSize() const {return size;};
+    void setMode(Mode mode) {this->mode = mode;};
+    Mode getMode() const {return mode;};
+    // glow size in full resolution pixels, sigma of the gaussian
+    void setRadius(float radius);
+    float getRadius() const {return radius;};
+    // only the part of a channel above threshold glows
+    void setThreshold(float threshold) {this->threshold = threshold;};
+    float getThreshold() const {return threshold;};
+
+    // image and tmp are interleaved rgb planes of the frame size, the result is written to image,
+    // image has to be zero outside of emissive, returns the part of image that can be non zero now,
+    // image is float or Half, tmp is float scratch
+    template<typename T>
+    QRect apply(T *image, float *tmp, const QRect &emissive);
+
+private:
+    struct Level {
+        // size for the current region, buffers are allocated for the largest frame
+        int w = 0, h = 0;
+        std::vector<float> data, tmp;
+    };
+
+    // image is the top left pixel of the w x h region, pitch values apart from one row to the next
+    template<typename T>
+    void applyGaussian(T *image, int pitch, float *tmp, int w, int h);
+    template<typename T>
+    void applyPyramid(T *image, int pitch, int w, int h);
+    // makes the chain deep enough for the radius
+    void buildLevels();
+    // how far the glow reaches from an emissive pixel
+    int margin() const;
+
+private:
+    QSize size;
+    // largest frame, levels are allocated for it
+    QSize capacity;
+    Mode mode = Mode::Pyramid;
+    float radius = 6.f;
+    float threshold = 0.f;
+    // 1/2, 1/4 ... of the frame
+    std::vector<Level> levels;
+    // levels used for the radius, the ones past it stay allocated
+    int activeLevels = 0;
+    // gaussian mode: emissive region copied out of the frame when it is not contiguous float
+    std::vector<float> region;
+};
+
+#endif // BLOOM_H
@@ -1,5 +1,7 @@
 #include "camera.h"
 
+#include <algorithm>
+#include <cmath>
 #include <numbers>
 
 Camera::Camera(float x, float y, float z, float sensitivity)
@@ -35,13 +37,38 @@ void Camera::moveUp(float top)
 
 void Camera::rotate(float x, float y)
 {
-    float dx = x - lastX;
-    float dy = y - lastY;
+    const float dx = x - lastX, dy = y - lastY;
     lastX = x;
     lastY = y;
+    turn(dx, dy);
+}
+
+void Camera::turn(float dx, float dy)
+{
     pitch = std::clamp(pitch + dy * sensitivity, -std::numbers::pi_v<float> * 0.499f, std::numbers::pi_v<float> * 0.499f);  // -pi/2 to pi/2
     yaw -= dx * sensitivity;
     //yaw = std::clamp(yaw + dy * sensitivity, -std::numbers::pi * 0.249, std::numbers::pi * 0.249);
+    updateAxes();
+}
+
+void Camera::reset(float x, float y)
+{
+    lastX = x;
+    lastY = y;
+}
+
+void Camera::lookAt(const Math::Vec3 &eye, const Math::Vec3 &target)
+{
+    this->eye = eye;
+    const Math::Vec3 dir = (target - eye).normalized();
+    // same limits as the mouse, straight up or down has no yaw
+    pitch = std::clamp(std::asin(dir.y()), -std::numbers::pi_v<float> * 0.499f, std::numbers::pi_v<float> * 0.499f);
+    yaw = std::atan2(dir.z(), dir.x());
+    updateAxes();
+}
+
+void Camera::updateAxes()
+{
     const float ax = cos(yaw) * cos(pitch);
     const float ay = sin(pitch);
     const float az = sin(yaw) * cos(pitch);
@@ -53,11 +80,4 @@ void Camera::rotate(float x, float y)
 
     //qInfo() << "direction" << direction;
     //qInfo() << "up" << up;
-
-}
-
-void Camera::reset(float x, float y)
-{
-    lastX = x;
-    lastY = y;
 }
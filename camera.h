@@ -25,7 +25,15 @@ public:
     void moveForward(float forward);
     void moveUp(float top);
     void rotate(float x, float y);
+    // the same by mouse pixels moved, without the last position
+    void turn(float dx, float dy);
     void reset(float x, float y);
+    // puts the eye at eye looking at target, for scripted camera paths
+    void lookAt(const Math::Vec3 &eye, const Math::Vec3 &target);
+
+protected:
+    // direction and up from pitch and yaw
+    void updateAxes();
 
 protected:
     float lastX;
@@ -0,0 +1,47 @@
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// lock free queue for one producer thread and one consumer thread,
+// the producer never waits: push fails when the consumer fell Capacity items behind
+template<typename T, int Capacity>
+class CommandQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer
+    bool push(const T &item)
+    {
+        const std::uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer
+    bool pop(T &item)
+    {
+        const std::uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    bool empty() const
+    {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // indices run freely and wrap, they are on their own cache lines so the threads do not share one
+    alignas(64) std::atomic<std::uint32_t> head{0};
+    alignas(64) std::atomic<std::uint32_t> tail{0};
+    alignas(64) std::array<T, Capacity> items;
+};
+
+#endif // COMMANDQUEUE_H
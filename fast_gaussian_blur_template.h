@@ -8,7 +8,35 @@
 #pragma once
 
 #include <type_traits>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <thread>
+
+// threading backend of the passes: FGB_BACKEND_OPENMP, FGB_BACKEND_STL or FGB_BACKEND_SERIAL,
+// defaults to OpenMP when it is enabled and to the standard parallel algorithms otherwise
+#if !defined(FGB_BACKEND_OPENMP) && !defined(FGB_BACKEND_STL) && !defined(FGB_BACKEND_SERIAL)
+#if defined(_OPENMP)
+#define FGB_BACKEND_OPENMP
+#else
+#define FGB_BACKEND_STL
+#endif
+#endif
+
+#if defined(FGB_BACKEND_STL)
+#include <execution>
+#include <numeric>
+#include <vector>
+#endif
+
+// float kernels for 3 and 4 channels are vectorized, two rows at a time with AVX
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FGB_SIMD_ROWS 2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FGB_SIMD_ROWS 1
+#endif
 
 //!
 //! \file fast_gaussian_blur_template.h
@@ -81,6 +109,53 @@ enum Kernel
     kLarge,
 };
 
+//!
+//! \brief Enumeration that describes how the vertical passes of fast_gaussian_blur are done.
+//!
+//! kTranspose flips the image with flip_block, runs the horizontal passes and flips it back.
+//! kDirect slides the kernel down strips of columns and does not move the image around, two full buffer copies less.
+//! kAuto picks one of them from the image size and number of channels, see choose_strategy.
+//!
+enum Strategy
+{
+    kTranspose,
+    kDirect,
+    kAuto,
+};
+
+//!
+//! \brief Runs f(i) for every i in [0, n) on the threads of the selected backend.
+//!
+//! The range is cut in a few contiguous chunks per hardware thread, so neighbouring rows or blocks
+//! stay on the same thread and the scheduling cost is paid per chunk, not per index.
+//!
+//! \param[in] n            number of indices
+//! \param[in] f            function called with each index, calls may run concurrently
+//!
+template<typename F>
+inline void parallel_for(const int n, F && f)
+{
+#if defined(FGB_BACKEND_SERIAL)
+    for(int i=0; i<n; i++) f(i);
+#else
+    static const int threads = std::max(1u, std::thread::hardware_concurrency());
+    const int chunks = std::min(n, 4*threads);
+    auto run = [&](const int c)
+    {
+        const int begin = int((long long)n*c/chunks), end = int((long long)n*(c+1)/chunks);
+        for(int i=begin; i<end; i++) f(i);
+    };
+#if defined(FGB_BACKEND_OPENMP)
+    #pragma omp parallel for schedule(static)
+    for(int c=0; c<chunks; c++) run(c);
+#else
+    std::vector<int> ids(std::max(chunks, 0));
+    std::iota(ids.begin(), ids.end(), 0);
+    std::for_each(std::execution::par_unseq, ids.cbegin(), ids.cend(), run);
+#endif
+#endif
+}
+
 //!
 //! \brief This function performs a single separable horizontal box blur pass with border extend policy.
 //! Templated by buffer data type T, buffer number of channels C.
@@ -99,8 +174,7 @@ inline void horizontal_blur_extend(const T * in, T * out, const int w, const int
     using calc_type = std::conditional_t<std::is_integral_v<T>, int, float>;
 
     const float iarr = 1.f / (r+r+1);
-    #pragma omp parallel for
-    for(int i=0; i<h; i++) 
+    parallel_for(h, [&](const int i)
     {
         const int begin = i*w;
         const int end = begin+w; 
@@ -210,7 +284,7 @@ inline void horizontal_blur_extend(const T * in, T * out, const int w, const int
                 out[ti*C+ch] = acc[ch]*iarr + (std::is_integral_v<T> ? 0.5f : 0.f); // fixes darkening with integer types
             }
         }
-    }
+    });
 }
 
 //!
@@ -232,8 +306,7 @@ inline void horizontal_blur_kernel_crop(const T * in, T * out, const int w, cons
 
     const float iarr = 1.f / (r+r+1);
     const float iwidth = 1.f / w;
-    #pragma omp parallel for
-    for(int i=0; i<h; i++) 
+    parallel_for(h, [&](const int i)
     {
         const int begin = i*w;
         const int end = begin+w; 
@@ -335,7 +408,7 @@ inline void horizontal_blur_kernel_crop(const T * in, T * out, const int w, cons
                 out[ti*C+ch] = acc[ch]*inorm + (std::is_integral_v<T> ? 0.5f : 0.f); // fixes darkening with integer types
             }
         }
-    }
+    });
 }
 
 //! Helper to compute array indices for mirror and wrap border policies.
@@ -383,8 +456,7 @@ inline void horizontal_blur_mirror(const T* in, T* out, const int w, const int h
     using calc_type = std::conditional_t<std::is_integral_v<T>, int, float>;
 
     const double iarr = 1.f/(r+r+1);
-    #pragma omp parallel for
-    for (int i = 0; i < h; i++)
+    parallel_for(h, [&](const int i)
     {
         const int begin = i*w;
         const int end = begin+w; 
@@ -503,7 +575,7 @@ inline void horizontal_blur_mirror(const T* in, T* out, const int w, const int h
                 out[ti*C+ch] = acc[ch]*iarr + (std::is_integral_v<T> ? 0.5f : 0.f); // fixes darkening with integer types
             }
         }
-    }
+    });
 }
 
 //!
@@ -525,8 +597,7 @@ inline void horizontal_blur_wrap(const T* in, T* out, const int w, const int h,
     using calc_type = std::conditional_t<std::is_integral_v<T>, int, float>;
 
     const float iarr = 1.f / (r+r+1);
-    #pragma omp parallel for
-    for(int i=0; i<h; i++) 
+    parallel_for(h, [&](const int i)
     {
         const int begin = i*w;
         const int end = begin+w; 
@@ -550,8 +621,192 @@ inline void horizontal_blur_wrap(const T* in, T* out, const int w, const int h,
             acc[ch] += in[rid*C+ch] - in[lid*C+ch];
             out[ti*C+ch] = acc[ch]*iarr + (std::is_integral_v<T> ? 0.5f : 0.f); // fixes darkening with integer types
         }
+    });
+}
+
+#if defined(FGB_SIMD_ROWS)
+//!
+//! \brief SIMD helpers for the float box blur kernels.
+//!
+//! A 3 or 4 channel float pixel is handled as one 4-wide SSE vector, RGB is padded with the first channel 
+//! of the next pixel which is never used. With AVX two rows are filtered at once, one in each 128-bit half,
+//! since every row of a pass follows the same index sequence.
+//!
+namespace simd_box
+{
+    //! floats in a vec
+    constexpr int width = 4*FGB_SIMD_ROWS;
+
+    //! one pixel, reading past the end of a 3 channel row is avoided for the last pixel by loading one float earlier
+    template<int C, bool Last = false>
+    inline __m128 load_px(const float * p)
+    {
+        if constexpr(C == 3 && Last)
+        {
+            const __m128 v = _mm_loadu_ps(p-1);
+            return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,2,1));
+        }
+        else return _mm_loadu_ps(p);
+    }
+
+    //! one pixel, a 3 channel pixel writes its padding lane over the next pixel that is stored later in the same row, 
+    //! except for the last pixel of the row
+    template<int C, bool Last = false>
+    inline void store_px(float * p, const __m128 v)
+    {
+        if constexpr(C == 3 && Last)
+        {
+            _mm_storel_pi((__m64*)p, v);
+            _mm_store_ss(p+2, _mm_movehl_ps(v, v));
+        }
+        else _mm_storeu_ps(p, v);
+    }
+
+#if FGB_SIMD_ROWS == 2
+    using vec = __m256;
+    inline vec set1(const float a)              { return _mm256_set1_ps(a); }
+    inline vec add(const vec a, const vec b)    { return _mm256_add_ps(a, b); }
+    inline vec sub(const vec a, const vec b)    { return _mm256_sub_ps(a, b); }
+    inline vec mul(const vec a, const vec b)    { return _mm256_mul_ps(a, b); }
+    inline vec loadu(const float * p)           { return _mm256_loadu_ps(p); }
+    inline void storeu(float * p, const vec v)  { _mm256_storeu_ps(p, v); }
+
+    //! the same pixel of rows p and p + stride
+    template<int C, bool Last = false>
+    inline vec load(const float * p, const int stride)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(load_px<C,Last>(p)), load_px<C,Last>(p+stride), 1);
+    }
+
+    template<int C, bool Last = false>
+    inline void store(float * p, const int stride, const vec v)
+    {
+        store_px<C,Last>(p, _mm256_castps256_ps128(v));
+        store_px<C,Last>(p+stride, _mm256_extractf128_ps(v, 1));
+    }
+#else
+    using vec = __m128;
+    inline vec set1(const float a)              { return _mm_set1_ps(a); }
+    inline vec add(const vec a, const vec b)    { return _mm_add_ps(a, b); }
+    inline vec sub(const vec a, const vec b)    { return _mm_sub_ps(a, b); }
+    inline vec mul(const vec a, const vec b)    { return _mm_mul_ps(a, b); }
+    inline vec loadu(const float * p)           { return _mm_loadu_ps(p); }
+    inline void storeu(float * p, const vec v)  { _mm_storeu_ps(p, v); }
+
+    template<int C, bool Last = false>
+    inline vec load(const float * p, const int)                 { return load_px<C,Last>(p); }
+
+    template<int C, bool Last = false>
+    inline void store(float * p, const int, const vec v)        { store_px<C,Last>(p, v); }
+#endif
+}
+
+//!
+//! \brief True when horizontal_blur has a SIMD version of the kSmall kernel for this buffer type, channel count and border policy.
+//!
+template<typename T, int C, Border P>
+constexpr bool has_simd_horizontal_blur = std::is_same_v<T, float> && (C == 3 || C == 4) && (P == kExtend || P == kMirror);
+
+//!
+//! \brief This function performs a single separable horizontal box blur pass on float buffers with SIMD instructions.
+//! Templated by buffer number of channels C (3 or 4) and border policy P (kExtend or kMirror).
+//! Same result as the scalar kSmall kernels (r < w/2), channels are filtered together and rows in pairs with AVX.
+//!
+//! \param[in] in           source buffer
+//! \param[in,out] out      target buffer
+//! \param[in] w            image width
+//! \param[in] h            image height
+//! \param[in] r            box dimension
+//!
+template<int C, Border P>
+inline void horizontal_blur_simd(const float * in, float * out, const int w, const int h, const int r)
+{
+    using namespace simd_box;
+    constexpr int R = FGB_SIMD_ROWS;
+    const int stride = w*C;
+    const int groups = h/R;
+    const vec iarr = set1(1.f / (r+r+1));
+
+    parallel_for(groups, [&](const int i)
+    {
+        const float * row = in + i*R*stride;
+        float * orow = out + i*R*stride;
+        // pixel x of the rows, the last one is loaded and stored without touching the next row
+        auto px = [&](const int x) { return x == w-1 ? load<C,true>(row + x*C, stride) : load<C>(row + x*C, stride); };
+        auto put = [&](const int x, const vec v)
+        {
+            if( x == w-1 )  store<C,true>(orow + x*C, stride, v);
+            else            store<C>(orow + x*C, stride, v);
+        };
+
+        // current index, left index, right index, relative to the row
+        int ti = 0, li = -r-1, ri = r;
+
+        if constexpr(P == kExtend)
+        {
+            const vec fv = px(0), lv = px(w-1);
+            vec acc = mul(set1(r+1), fv);
+            for(int j=0; j<r; j++) acc = add(acc, px(j));
+
+            // 1. left side out and right side in
+            for(; li<0; ri++, ti++, li++)
+            {
+                acc = add(acc, sub(px(ri), fv));
+                put(ti, mul(acc, iarr));
+            }
+
+            // 2. left side in and right side in
+            for(; ri<w; ri++, ti++, li++)
+            {
+                acc = add(acc, sub(px(ri), px(li)));
+                put(ti, mul(acc, iarr));
+            }
+
+            // 3. left side in and right side out
+            for(; ti<w; ti++, li++)
+            {
+                acc = add(acc, sub(lv, px(li)));
+                put(ti, mul(acc, iarr));
+            }
+        }
+        else if constexpr(P == kMirror)
+        {
+            vec acc = set1(0.f);
+            for(int j=li; j<0; j++) acc = add(acc, px(-j));
+            for(int j=0; j<ri; j++) acc = add(acc, px(j));
+
+            // 1. left side out and right side in
+            for(; li<0; ri++, ti++, li++)
+            {
+                acc = add(acc, sub(px(ri), px(-li)));
+                put(ti, mul(acc, iarr));
+            }
+
+            // 2. left side in and right side in
+            for(; ri<w; ri++, ti++, li++)
+            {
+                acc = add(acc, sub(px(ri), px(li)));
+                put(ti, mul(acc, iarr));
+            }
+
+            // 3. left side in and right side out
+            for(; ti<w; ri++, ti++, li++)
+            {
+                acc = add(acc, sub(px(2*w-2-ri), px(li)));
+                put(ti, mul(acc, iarr));
+            }
+        }
+    });
+
+    // rows left over from the pairs
+    if( groups*R < h )
+    {
+        const int offset = groups*R*stride;
+        if constexpr(P == kExtend)  horizontal_blur_extend<float,C,kSmall>(in + offset, out + offset, w, h - groups*R, r);
+        else                        horizontal_blur_mirror<float,C,kSmall>(in + offset, out + offset, w, h - groups*R, r);
     }
 }
+#endif
 
 //!
 //! \brief Utility template dispatcher function for horizontal_blur.
@@ -566,6 +821,13 @@ inline void horizontal_blur_wrap(const T* in, T* out, const int w, const int h,
 template<typename T, int C, Border P = kMirror>
 inline void horizontal_blur(const T * in, T * out, const int w, const int h, const int r)
 {
+#if defined(FGB_SIMD_ROWS)
+    if constexpr(has_simd_horizontal_blur<T,C,P>)
+    {
+        if( r < w/2 ) { horizontal_blur_simd<C,P>(in, out, w, h, r); return; }
+    }
+#endif
+
     if constexpr(P == kExtend)
     {
         if( r < w/2 )       horizontal_blur_extend<T,C,Kernel::kSmall>(in, out, w, h, r);
@@ -581,7 +843,7 @@ inline void horizontal_blur(const T * in, T * out, const int w, const int h, con
     else if constexpr(P == kMirror)
     {
         if( r < w/2 )       horizontal_blur_mirror<T,C,Kernel::kSmall>(in, out, w, h, r);
-        else if( r < w )    horizontal_blur_mirror<T,C,Kernel::kMid  >(in, out, w, h, r);
+        else if( r < w-1 )  horizontal_blur_mirror<T,C,Kernel::kMid  >(in, out, w, h, r); // the mirrored index r+1 has to stay in the row
         else                horizontal_blur_mirror<T,C,Kernel::kLarge>(in, out, w, h, r);
     }
     else if constexpr(P == kWrap)
@@ -630,10 +892,12 @@ template<typename T, int C>
 inline void flip_block(const T * in, T * out, const int w, const int h)
 {
     constexpr int block = 256/C;
-    #pragma omp parallel for collapse(2)
-    for(int x= 0; x < w; x+= block)
-    for(int y= 0; y < h; y+= block)
+    const int blocksx = (w + block - 1) / block;
+    const int blocksy = (h + block - 1) / block;
+    parallel_for(blocksx * blocksy, [&](const int b)
     {
+        const int x = (b % blocksx) * block;
+        const int y = (b / blocksx) * block;
         const T * p = in + y*w*C + x*C;
         T * q = out + y*C + x*h*C;
         
@@ -651,7 +915,7 @@ inline void flip_block(const T * in, T * out, const int w, const int h)
             p+= -blocky*w*C + C;
             q+= -blocky*C + h*C;
         }
-    }
+    });
 }
 //!
 //! \brief Utility template dispatcher function for flip_block. Templated by buffer data type T.
@@ -676,6 +940,127 @@ inline void flip_block(const T * in, T * out, const int w, const int h, const in
     }
 }
 
+//!
+//! \brief Source row of a row index outside of the image for the direct vertical passes, same policies as the horizontal ones.
+//!
+template<Border P>
+inline int border_row(const int h, const int y)
+{
+    if constexpr(P == kExtend)      return std::clamp(y, 0, h-1);
+    else if constexpr(P == kMirror) return h > 1 ? Index::mirror(0, h, y) : 0;
+    else                            return Index::wrap(0, h, y);
+}
+
+//!
+//! \brief One step of the sliding window of a column strip: acc += add - sub, out = acc * iarr.
+//! Float strips are processed several columns per SIMD register.
+//!
+template<typename T, typename A>
+inline void slide_strip(A * acc, const T * add, const T * sub, T * out, const int n, const float iarr)
+{
+    int k = 0;
+#if defined(FGB_SIMD_ROWS)
+    if constexpr(std::is_same_v<T, float>)
+    {
+        const simd_box::vec vi = simd_box::set1(iarr);
+        for(; k + simd_box::width <= n; k += simd_box::width)
+        {
+            const simd_box::vec v = simd_box::add(simd_box::loadu(acc+k), simd_box::sub(simd_box::loadu(add+k), simd_box::loadu(sub+k)));
+            simd_box::storeu(acc+k, v);
+            simd_box::storeu(out+k, simd_box::mul(v, vi));
+        }
+    }
+#endif
+    for(; k < n; k++)
+    {
+        acc[k] += add[k] - sub[k];
+        out[k] = acc[k]*iarr + (std::is_integral_v<T> ? 0.5f : 0.f); // fixes darkening with integer types
+    }
+}
+
+//!
+//! \brief This function performs a single separable vertical box blur pass without transposing the image.
+//! Templated by buffer data type T and border policy P (kExtend, kMirror or kWrap).
+//!
+//! A row is w*c contiguous values whatever the channels, so the image is cut in strips of values that are blurred 
+//! down the rows independently, with one accumulator per value. The result is the same as flip_block, 
+//! horizontal_blur and flip_block again.
+//!
+//! \param[in] in           source buffer
+//! \param[in,out] out      target buffer
+//! \param[in] w            image width
+//! \param[in] h            image height
+//! \param[in] c            image channels
+//! \param[in] r            box dimension
+//!
+template<typename T, Border P>
+inline void vertical_blur(const T * in, T * out, const int w, const int h, const int c, const int r)
+{
+    static_assert(P != kKernelCrop, "kernel crop has no direct vertical pass");
+
+    // change the local variable types depending on the template type for faster calculations
+    using calc_type = std::conditional_t<std::is_integral_v<T>, int, float>;
+
+    // values per strip, the accumulators stay in L1 and each row access is a few whole cache lines
+    constexpr int strip = 128;
+    const int stride = w*c;
+    const int strips = (stride + strip - 1) / strip;
+    const float iarr = 1.f / (r+r+1);
+    parallel_for(strips, [&](const int s)
+    {
+        const int x0 = s*strip;
+        const int n = std::min(stride, x0 + strip) - x0;
+        auto row = [&](const int y) { return in + border_row<P>(h, y)*stride + x0; };
+
+        // initial accumulation, in the order of the horizontal kernels
+        calc_type acc[strip];
+        if constexpr(P == kExtend)
+        {
+            const T * first = row(0);
+            for(int k=0; k<n; k++) acc[k] = (r+1)*first[k];
+            for(int j=0; j<r; j++)
+            {
+                const T * p = row(j);
+                for(int k=0; k<n; k++) acc[k] += p[k];
+            }
+        }
+        else
+        {
+            std::fill(acc, acc + n, calc_type(0));
+            for(int j=-r-1; j<r; j++)
+            {
+                const T * p = row(j);
+                for(int k=0; k<n; k++) acc[k] += p[k];
+            }
+        }
+
+        // perform filtering
+        for(int ti=0; ti<h; ti++)
+            slide_strip(acc, row(ti+r), row(ti-r-1), out + ti*stride + x0, n, iarr);
+    });
+}
+
+//!
+//! \brief Picks the vertical pass strategy for kAuto.
+//!
+//! Measured on float images: the direct passes win for 1 to 3 channels at every size, they are fully vectorized 
+//! over the strip while the horizontal kernels keep a dependency chain per pixel, and they save the two flips.
+//! With 4 channels the horizontal kernels use whole registers too, and past a few ten MB the large row stride 
+//! of the strips costs more than the flips. Kernel crop has no direct version.
+//!
+//! \param[in] w            image width
+//! \param[in] h            image height
+//! \param[in] c            image channels
+//!
+template<typename T, Border P>
+inline Strategy choose_strategy(const int w, const int h, const int c)
+{
+    if constexpr(P == kKernelCrop)
+        return kTranspose;
+    else
+        return c < 4 || size_t(w)*h*c*sizeof(T) < (size_t(16) << 20) ? kDirect : kTranspose;
+}
+
 //!
 //! \brief This function converts the standard deviation of 
 //! Gaussian blur into a box radius for each box blur pass. 
@@ -721,6 +1106,8 @@ inline float sigma_to_box_radius(int boxes[], const float sigma, const int n)
 //! - apply N times horizontal blur (vertical passes)
 //! - flip the image buffer (transposition)
 //!
+//! or, with the kDirect strategy, N vertical_blur passes instead of the flips and the second horizontal passes.
+//!
 //! We provide two version of the function:
 //! - generic N passes (in which more std::swap are used)
 //! - specialized 3 passes only
@@ -731,9 +1118,10 @@ inline float sigma_to_box_radius(int boxes[], const float sigma, const int n)
 //! \param[in] h            image height
 //! \param[in] c            image channels
 //! \param[in] sigma        Gaussian standard deviation
+//! \param[in] s            vertical pass strategy {kTranspose, kDirect}
 //!
 template<typename T, unsigned int N, Border P>
-inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma) 
+inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma, const Strategy s) 
 {
     // compute box kernel sizes
     int boxes[N];
@@ -746,6 +1134,22 @@ inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, cons
         std::swap(in, out);
     }   
 
+    // the direct vertical kernel has no crop policy, crop always goes through the flips
+    if constexpr( P != kKernelCrop )
+    {
+        if( s == kDirect )
+        {
+            // perform N vertical blur passes in place of the flips
+            for(unsigned int i = 0; i < N; ++i)
+            {
+                vertical_blur<T,P>(in, out, w, h, c, boxes[i]);
+                std::swap(in, out);
+            }
+            std::swap(in, out);
+            return;
+        }
+    }
+
     // flip buffer
     flip_block(in, out, w, h, c);
     std::swap(in, out);
@@ -763,7 +1167,7 @@ inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, cons
 
 // specialized 3 passes
 template<typename T, Border P>
-inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma) 
+inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma, const Strategy s) 
 {
     // compute box kernel sizes
     int boxes[3];
@@ -774,6 +1178,22 @@ inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, cons
     horizontal_blur<T,P>(out, in, w, h, c, boxes[1]);
     horizontal_blur<T,P>(in, out, w, h, c, boxes[2]);
     
+    // the direct vertical kernel has no crop policy, crop always goes through the flips
+    if constexpr( P != kKernelCrop )
+    {
+        if( s == kDirect )
+        {
+            // perform 3 vertical blur passes in place of the flips
+            vertical_blur<T,P>(out, in, w, h, c, boxes[0]);
+            vertical_blur<T,P>(in, out, w, h, c, boxes[1]);
+            vertical_blur<T,P>(out, in, w, h, c, boxes[2]);
+
+            // swap pointers to get result in the ouput buffer 
+            std::swap(in, out);
+            return;
+        }
+    }
+
     // flip buffer
     flip_block(out, in, w, h, c);
     
@@ -801,22 +1221,26 @@ inline void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, cons
 //! \param[in] c            image channels
 //! \param[in] sigma        Gaussian standard deviation
 //! \param[in] n            number of passes, should be > 0
+//! \param[in] s            vertical pass strategy {kTranspose, kDirect, kAuto}
 //!
 template<typename T, Border P = kMirror>
-void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma, const unsigned int n) 
+void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma, const unsigned int n, Strategy s = kAuto) 
 {
+    if( s == kAuto )
+        s = choose_strategy<T,P>(w, h, c);
+
     switch(n)
     {
-        case 1: fast_gaussian_blur<T,1,P>(in, out, w, h, c, sigma); break;
-        case 2: fast_gaussian_blur<T,2,P>(in, out, w, h, c, sigma); break;
-        case 3: fast_gaussian_blur<T,  P>(in, out, w, h, c, sigma); break; // specialized 3 passes version
-        case 4: fast_gaussian_blur<T,4,P>(in, out, w, h, c, sigma); break;
-        case 5: fast_gaussian_blur<T,5,P>(in, out, w, h, c, sigma); break;
-        case 6: fast_gaussian_blur<T,6,P>(in, out, w, h, c, sigma); break;
-        case 7: fast_gaussian_blur<T,7,P>(in, out, w, h, c, sigma); break;
-        case 8: fast_gaussian_blur<T,8,P>(in, out, w, h, c, sigma); break;
-        case 9: fast_gaussian_blur<T,9,P>(in, out, w, h, c, sigma); break;
-        case 10: fast_gaussian_blur<T,10,P>(in, out, w, h, c, sigma); break;
+        case 1: fast_gaussian_blur<T,1,P>(in, out, w, h, c, sigma, s); break;
+        case 2: fast_gaussian_blur<T,2,P>(in, out, w, h, c, sigma, s); break;
+        case 3: fast_gaussian_blur<T,  P>(in, out, w, h, c, sigma, s); break; // specialized 3 passes version
+        case 4: fast_gaussian_blur<T,4,P>(in, out, w, h, c, sigma, s); break;
+        case 5: fast_gaussian_blur<T,5,P>(in, out, w, h, c, sigma, s); break;
+        case 6: fast_gaussian_blur<T,6,P>(in, out, w, h, c, sigma, s); break;
+        case 7: fast_gaussian_blur<T,7,P>(in, out, w, h, c, sigma, s); break;
+        case 8: fast_gaussian_blur<T,8,P>(in, out, w, h, c, sigma, s); break;
+        case 9: fast_gaussian_blur<T,9,P>(in, out, w, h, c, sigma, s); break;
+        case 10: fast_gaussian_blur<T,10,P>(in, out, w, h, c, sigma, s); break;
         default: printf("fast_gaussian_blur with %d passes is not supported yet. Add a specific case if possible or fall back to the generic version.\n", n); break;
         // default: fast_gaussian_blur<T,10>(in, out, w, h, c, sigma, n); break;
     }
@@ -835,15 +1259,16 @@ void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c
 //! \param[in] sigma        Gaussian standard deviation
 //! \param[in] n            number of passes, should be > 0
 //! \param[in] p            border policy {kExtend, kMirror, kKernelCrop, kWrap}
+//! \param[in] s            vertical pass strategy {kTranspose, kDirect, kAuto}
 //!
 template<typename T>
-void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma, const unsigned int n, const Border p)
+void fast_gaussian_blur(T *& in, T *& out, const int w, const int h, const int c, const float sigma, const unsigned int n, const Border p, const Strategy s = kAuto)
 {
     switch(p)
     {
-        case kExtend:       fast_gaussian_blur<T, kExtend>       (in, out, w, h, c, sigma, n); break;
-        case kMirror:       fast_gaussian_blur<T, kMirror>       (in, out, w, h, c, sigma, n); break;
-        case kKernelCrop:   fast_gaussian_blur<T, kKernelCrop>   (in, out, w, h, c, sigma, n); break;
-        case kWrap:         fast_gaussian_blur<T, kWrap>         (in, out, w, h, c, sigma, n); break;
+        case kExtend:       fast_gaussian_blur<T, kExtend>       (in, out, w, h, c, sigma, n, s); break;
+        case kMirror:       fast_gaussian_blur<T, kMirror>       (in, out, w, h, c, sigma, n, s); break;
+        case kKernelCrop:   fast_gaussian_blur<T, kKernelCrop>   (in, out, w, h, c, sigma, n, s); break;
+        case kWrap:         fast_gaussian_blur<T, kWrap>         (in, out, w, h, c, sigma, n, s); break;
     }
 }
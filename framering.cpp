@@ -0,0 +1,51 @@
+#include "framering.h"
+
+#include <QMutexLocker>
+
+FrameRing::FrameRing(QSize size, int count)
+{
+    Q_ASSERT(count == 2 || count == 3);
+    for (int i = 0; i < count; ++i) {
+        targets.push_back({QImage(size, QImage::Format_RGB32)});
+    }
+}
+
+int FrameRing::acquire()
+{
+    QMutexLocker lock(&mutex);
+    int ready = -1;
+    for (int i = 0; i < count(); ++i) {
+        if (targets[i].state == State::Free) {
+            targets[i].state = State::Rendering;
+            return i;
+        }
+        if (targets[i].state == State::Ready) ready = i;
+    }
+    // the renderer holds no target when it asks, so at most one slot is displayed and the rest is free or ready
+    Q_ASSERT(ready >= 0);
+    targets[ready].state = State::Rendering;
+    return ready;
+}
+
+void FrameRing::publish(int slot)
+{
+    QMutexLocker lock(&mutex);
+    for (auto &s : targets) {
+        if (s.state == State::Ready) s.state = State::Free;
+    }
+    targets[slot].state = State::Ready;
+}
+
+int FrameRing::present()
+{
+    QMutexLocker lock(&mutex);
+    int ready = -1, displayed = -1;
+    for (int i = 0; i < count(); ++i) {
+        if (targets[i].state == State::Ready) ready = i;
+        if (targets[i].state == State::Displayed) displayed = i;
+    }
+    if (ready < 0) return displayed;
+    if (displayed >= 0) targets[displayed].state = State::Free;
+    targets[ready].state = State::Displayed;
+    return ready;
+}
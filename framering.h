@@ -0,0 +1,64 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include "vec3.h"
+
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+
+#include <vector>
+
+// frame targets passed between the renderer and the presenter, every target is owned by one side at a time,
+// so the image on screen is never written and the renderer never waits for the screen
+class FrameRing
+{
+public:
+    enum class State {
+        Free,       // nobody uses it
+        Rendering,  // renderer draws into it
+        Ready,      // finished, not shown yet
+        Displayed,  // presenter shows it
+    };
+
+    // what a frame was rendered with, travels with its image
+    struct Info {
+        Math::Vec3 eye; // camera position
+        QSize size;     // render size, the image is scaled up from it
+    };
+
+public:
+    // 2 or 3 targets, with 2 a finished frame that was not shown yet is drawn over by the next one
+    explicit FrameRing(QSize size, int count = 3);
+
+public:
+    // renderer: a target to draw into, the finished frame that was not shown yet if nothing is free
+    int acquire();
+    // renderer: the frame in slot is finished, an older finished one that was never shown is dropped,
+    // so there is at most one ready frame
+    void publish(int slot);
+    // presenter: shows the finished frame if there is one, the previously shown target is free again,
+    // returns the slot on screen, -1 before the first frame
+    int present();
+
+    // only the owner of the slot uses these
+    QImage &image(int slot) {return targets[slot].image;};
+    const QImage &image(int slot) const {return targets[slot].image;};
+    Info &info(int slot) {return targets[slot].info;};
+    const Info &info(int slot) const {return targets[slot].info;};
+    int count() const {return int(targets.size());};
+    QSize size() const {return targets.front().image.size();};
+
+private:
+    struct Slot {
+        QImage image;
+        Info info;
+        State state = State::Free;
+    };
+
+    mutable QMutex mutex;
+    // not implicitly shared, both threads index it
+    std::vector<Slot> targets;
+};
+
+#endif // FRAMERING_H
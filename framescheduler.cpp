@@ -0,0 +1,98 @@
+#include "framescheduler.h"
+
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(QObject *parent)
+    : QObject{parent}
+{
+    clock.start();
+    // single shot: at most one frame is pending, a slow frame can not make timeouts pile up
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    QObject::connect(timer, &QTimer::timeout, this, &FrameScheduler::due);
+    // the first frame
+    schedule();
+}
+
+void FrameScheduler::setMode(Mode mode)
+{
+    this->mode = mode;
+    // a frame waiting for the old cadence is rescheduled
+    timer->stop();
+    schedule();
+}
+
+void FrameScheduler::setTargetFps(int fps)
+{
+    targetFps = std::max(fps, 1);
+    timer->stop();
+    schedule();
+}
+
+void FrameScheduler::setPaused(bool paused)
+{
+    this->paused = paused;
+    if (paused) {
+        timer->stop();
+    } else {
+        schedule();
+    }
+}
+
+void FrameScheduler::frameStarted()
+{
+    lastStart = clock.nsecsElapsed();
+    // changes from now on go into the next frame
+    refinement = !changed;
+    changed = false;
+    dirty = false;
+    rendering = true;
+}
+
+void FrameScheduler::frameFinished()
+{
+    last = (clock.nsecsElapsed() - lastStart) / 1e6;
+    average = average == 0 ? last : average * 0.9 + last * 0.1;
+    rendering = false;
+    unpresented = true;
+    schedule();
+}
+
+void FrameScheduler::refine()
+{
+    dirty = true;
+    schedule();
+}
+
+void FrameScheduler::invalidate()
+{
+    changed = true;
+    dirty = true;
+    schedule();
+}
+
+void FrameScheduler::presented()
+{
+    unpresented = false;
+    schedule();
+}
+
+void FrameScheduler::schedule()
+{
+    if (paused || !dirty || rendering || timer->isActive()) return;
+    if (mode == Mode::OnDemand && unpresented) return;
+    qint64 delay = 0;
+    if (mode == Mode::TargetFps && lastStart >= 0) {
+        // keep the cadence from the start of the last frame, it already used part of the period
+        delay = std::max<qint64>(lastStart + 1000000000ll / targetFps - clock.nsecsElapsed(), 0);
+    }
+    timer->start(int((delay + 999999) / 1000000));
+}
+
+void FrameScheduler::due()
+{
+    // the frame may have been rendered without the timer since it was started
+    if (paused || !dirty) return;
+    emit frameDue();
+}
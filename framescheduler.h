@@ -0,0 +1,85 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+// decides when the renderer draws, a frame is only rendered if something changed since the last one,
+// lives on the render thread
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Mode {
+        TargetFps,     // frames start at most every 1 / target fps, a late frame is followed right away, never by a backlog
+        MaxThroughput, // the next frame starts as soon as the previous one finished
+        OnDemand,      // the next frame waits until the presenter took the previous one, nothing is rendered to be dropped
+    };
+    // cycles through the modes, a new one is a -Wswitch warning here until it has its place
+    static constexpr Mode next(Mode mode)
+    {
+        switch (mode) {
+        case Mode::TargetFps: return Mode::MaxThroughput;
+        case Mode::MaxThroughput: return Mode::OnDemand;
+        case Mode::OnDemand: return Mode::TargetFps;
+        }
+        return Mode::TargetFps;
+    }
+
+public:
+    explicit FrameScheduler(QObject *parent = nullptr);
+
+public:
+    void setMode(Mode mode);
+    Mode getMode() const {return mode;};
+    void setTargetFps(int fps);
+    int getTargetFps() const {return targetFps;};
+    void setPaused(bool paused);
+    bool isPaused() const {return paused;};
+
+    // the renderer calls these around every frame, also when it was not started by frameDue
+    void frameStarted();
+    void frameFinished();
+    // cost of the last frame and a running average, in ms
+    double lastCost() const {return last;};
+    double averageCost() const {return average;};
+    // the last frame is not final (rendered at a lower size), the same scene is rendered again
+    // when nothing else asks for a frame first
+    void refine();
+    // nothing invalidated the frame in progress, it only refines the last one
+    bool isRefinement() const {return refinement;};
+
+public Q_SLOTS:
+    // the scene changed, the next frame is not the same as the last one
+    void invalidate();
+    // the presenter took the last finished frame
+    void presented();
+
+Q_SIGNALS:
+    void frameDue();
+
+private:
+    void schedule();
+    void due();
+
+private:
+    QTimer *timer;
+    // frame start times are measured on it
+    QElapsedTimer clock;
+    qint64 lastStart = -1; // ns
+    double last = 0, average = 0;
+
+    Mode mode = Mode::TargetFps;
+    int targetFps = 60;
+    bool paused = false;
+    bool dirty = true;
+    // dirty because of invalidate, not only because of refine
+    bool changed = true;
+    bool refinement = false;
+    bool rendering = false;
+    bool unpresented = false;
+};
+
+#endif // FRAMESCHEDULER_H
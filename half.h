@@ -0,0 +1,58 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+// ieee 754 binary16 storage, math is done in float after conversion
+struct Half
+{
+    std::uint16_t bits = 0;
+};
+
+inline float toFloat(Half h)
+{
+#if defined(__F16C__)
+    return _cvtsh_ss(h.bits);
+#else
+    const std::uint32_t sign = std::uint32_t(h.bits & 0x8000) << 16;
+    const std::uint32_t exp = (h.bits >> 10) & 0x1f, mant = h.bits & 0x3ff;
+    if (exp == 0x1f) { // inf, nan
+        return std::bit_cast<float>(sign | 0x7f800000u | mant << 13);
+    }
+    if (exp == 0) { // zero, subnormal: mant * 2^-24
+        const float f = float(mant) * 0x1p-24f;
+        return sign ? -f : f;
+    }
+    return std::bit_cast<float>(sign | (exp + 127 - 15) << 23 | mant << 13);
+#endif
+}
+
+// rounds to nearest even, too big values become inf
+inline Half toHalf(float f)
+{
+#if defined(__F16C__)
+    return {std::uint16_t(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT))};
+#else
+    std::uint32_t x = std::bit_cast<std::uint32_t>(f);
+    const std::uint16_t sign = std::uint16_t((x >> 16) & 0x8000);
+    x &= 0x7fffffffu;
+    std::uint16_t bits;
+    if (x >= 0x47800000u) { // 2^16 and more, inf, nan stays nan
+        bits = x > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (x < 0x38800000u) { // below 2^-14: subnormal or zero, the float add rounds the mantissa
+        bits = std::uint16_t(std::bit_cast<std::uint32_t>(std::bit_cast<float>(x) + 0.5f) - 0x3f000000u);
+    } else {
+        // rebias the exponent, + 0xfff and the lowest kept bit round to nearest even
+        x += ((15u - 127u) << 23) + 0xfffu + ((x >> 13) & 1);
+        bits = std::uint16_t(x >> 13);
+    }
+    return {std::uint16_t(bits | sign)};
+#endif
+}
+
+#endif // HALF_H
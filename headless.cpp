@@ -0,0 +1,155 @@
+// renders a model along an orbit around the origin without a window and reports the frame times,
+// for machines without a display server and for performance regression runs
+#include "objLoader.h"
+#include "plotter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// portable float map, bottom row first, hdr frames without an exr library
+bool writePfm(const QString &path, const float *rgb, QSize size)
+{
+    FILE *file = std::fopen(QFile::encodeName(path).constData(), "wb");
+    if (!file) return false;
+    std::fprintf(file, "PF\n%d %d\n-1.0\n", size.width(), size.height());
+    for (int y = size.height() - 1; y >= 0; --y) {
+        std::fwrite(rgb + qsizetype(y) * size.width() * 3, sizeof(float), size.width() * 3, file);
+    }
+    return std::fclose(file) == 0;
+}
+
+// the rgb floats as they are, little endian
+bool writeRaw(const QString &path, const float *rgb, QSize size)
+{
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return false;
+    const qint64 bytes = qint64(size.width()) * size.height() * 3 * sizeof(float);
+    return file.write((const char *)rgb, bytes) == bytes;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // no gui application, the scheduler timer only needs an event dispatcher
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("headless");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders an obj model along an orbit around the origin and reports the frame times.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("model", "Wavefront obj file.");
+    parser.addOptions({
+        {{"n", "frames"}, "Number of frames.", "n", "1"},
+        {{"s", "size"}, "Output size.", "WxH", "1440x960"},
+        {{"o", "output"}, "Directory of the frames.", "dir", "."},
+        {{"f", "format"}, "png, pfm (hdr), raw (hdr rgb floats) or none.", "format", "png"},
+        {"orbit", "Distance of the camera from the origin.", "radius", "2"},
+        {"height", "Height of the camera above the origin.", "height", "0"},
+        {"turns", "Turns around the origin over all frames.", "turns", "1"},
+        {"raster", "scanline or halfspace.", "mode", "scanline"},
+        {"shading", "deferred or forward.", "mode", "deferred"},
+        {"tonemap", "reinhard, aces or uncharted2.", "operator", "reinhard"},
+        {"srgb", "Encode the output as srgb."},
+        {"bloom", "pyramid or gaussian.", "mode", "pyramid"},
+        {"half", "Half precision hdr planes."},
+        {"dynamic-resolution", "Scale the render size to this frame time.", "ms"},
+    });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+    const QStringList wh = parser.value("size").split('x');
+    const QSize size = wh.size() == 2 ? QSize(wh[0].toInt(), wh[1].toInt()) : QSize();
+    const int count = parser.value("frames").toInt();
+    const QString format = parser.value("format");
+    if (size.isEmpty() || count <= 0 || !QStringList{"png", "pfm", "raw", "none"}.contains(format)) {
+        std::fprintf(stderr, "bad size, frame count or format\n");
+        return 1;
+    }
+    const QDir output(parser.value("output"));
+    if (format != "none" && !output.mkpath(".")) {
+        std::fprintf(stderr, "can not create %s\n", qPrintable(output.path()));
+        return 1;
+    }
+
+    Mesh mesh;
+    if (!loadOBJ(QFile(parser.positionalArguments().first()), mesh)) {
+        std::fprintf(stderr, "can not load %s\n", qPrintable(parser.positionalArguments().first()));
+        return 1;
+    }
+    if (mesh.colors.isEmpty()) {
+        mesh.colors.fill(Math::Vec3{1, 1, 1}, mesh.positions.size());
+    }
+
+    Plotter plotter(size);
+    // frames are rendered here one after another, not by the timer
+    plotter.getScheduler()->setPaused(true);
+    plotter.setData(std::move(mesh));
+    plotter.setRasterMode(parser.value("raster") == "halfspace" ? Plotter::RasterMode::HalfSpace
+                                                                : Plotter::RasterMode::Scanline);
+    plotter.setShadingMode(parser.value("shading") == "forward" ? Plotter::ShadingMode::Forward
+                                                                : Plotter::ShadingMode::Deferred);
+    const QString tonemap = parser.value("tonemap");
+    plotter.setTonemap(tonemap == "aces" ? Tonemap::Operator::Aces
+                       : tonemap == "uncharted2" ? Tonemap::Operator::Uncharted2
+                                                 : Tonemap::Operator::Reinhard);
+    plotter.setSrgb(parser.isSet("srgb"));
+    plotter.setBloomMode(parser.value("bloom") == "gaussian" ? Bloom::Mode::Gaussian : Bloom::Mode::Pyramid);
+    plotter.setBufferFormat(parser.isSet("half") ? Plotter::BufferFormat::Float16 : Plotter::BufferFormat::Float32);
+    if (parser.isSet("dynamic-resolution")) {
+        plotter.setDynamicResolution(true);
+        plotter.setTargetFrameTime(parser.value("dynamic-resolution").toFloat());
+    }
+
+    const float radius = parser.value("orbit").toFloat(), height = parser.value("height").toFloat();
+    const float turns = parser.value("turns").toFloat();
+    std::vector<double> times(count);
+    std::vector<float> hdr;
+    for (int i = 0; i < count; ++i) {
+        const float angle = 2 * std::numbers::pi_v<float> * turns * i / count;
+        plotter.getCamera()->lookAt({radius * std::sin(angle), height, radius * std::cos(angle)}, {0, 0, 0});
+        // the camera is moved without a command, a frame with the same input would only be a refinement
+        plotter.getScheduler()->invalidate();
+
+        QElapsedTimer timer;
+        timer.start();
+        plotter.plot();
+        times[i] = timer.nsecsElapsed() / 1e6;
+        const QSize renderSize = plotter.getRenderSize();
+        std::printf("frame %d: %.3f ms %dx%d\n", i, times[i], renderSize.width(), renderSize.height());
+
+        const QString name = output.filePath(QString("frame_%1.%2").arg(i, 4, 10, QChar('0')).arg(format));
+        bool written = true;
+        if (format == "png") {
+            FrameRing &frames = plotter.getFrames();
+            written = frames.image(frames.present()).save(name);
+        } else if (format != "none") {
+            hdr.resize(qsizetype(renderSize.width()) * renderSize.height() * 3);
+            plotter.readHdr(hdr.data());
+            written = format == "pfm" ? writePfm(name, hdr.data(), renderSize) : writeRaw(name, hdr.data(), renderSize);
+        }
+        if (!written) {
+            std::fprintf(stderr, "can not write %s\n", qPrintable(name));
+            return 1;
+        }
+    }
+
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    std::printf("frames %d min %.3f ms median %.3f ms avg %.3f ms max %.3f ms\n", count, sorted.front(),
+                sorted[count / 2], std::accumulate(times.begin(), times.end(), 0.0) / count, sorted.back());
+    return 0;
+}
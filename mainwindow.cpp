@@ -7,6 +7,16 @@
 #include <QThread>
 #include <QDebug>
 
+namespace {
+using Command = Plotter::Command;
+// applied on the render thread, the amounts are in the command
+void moveForward(Plotter &p, const Command &c) {p.getCamera()->moveForward(c.x);}
+void moveSide(Plotter &p, const Command &c) {p.getCamera()->moveSide(c.x);}
+void moveUp(Plotter &p, const Command &c) {p.getCamera()->moveUp(c.x);}
+void rotateModel(Plotter &p, const Command &c) {p.rotate(c.x, c.y, c.z);}
+void zoom(Plotter &p, const Command &c) {p.zoom(c.x);}
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , drawtime(0)
@@ -17,13 +27,7 @@ MainWindow::MainWindow(QWidget *parent)
     // Setup plotter
     plotter = new Plotter(QSize(2880 / 2 , 1920 / 2 ));
     // temp
-    QVector < Math::Vec3 > vertices;
-    QVector < QVector<std::tuple<int, int, int>> > indices;
-    QVector < Math::Vec3 > normals;
-    QVector < Math::Vec3 > colors;
-    QVector < Math::Vec3 > textures;
-    QVector < int > texIDs;
-    QVector < TexInfo > texture;
+    Mesh mesh;
     // Material Ball/export3dcoat.obj
     // Cyber Mancubus/mancubus.obj
     // Cube/cube.obj
@@ -34,15 +38,15 @@ MainWindow::MainWindow(QWidget *parent)
     // Doom Slayer/doomslayer.obj
     // Cat/test.obj
     //
-    if (loadOBJ(QFile("./Models/Cyber Mancubus/mancubus.obj"), vertices, indices, normals, colors, textures, texIDs, texture))
+    if (loadOBJ(QFile("./Models/Cyber Mancubus/mancubus.obj"), mesh))
     {
         qDebug() << "Data loaded";
-        if (colors.empty()) {
-            colors.fill(Math::Vec3{1, 1, 1}, vertices.size());
+        if (mesh.colors.isEmpty()) {
+            mesh.colors.fill(Math::Vec3{1, 1, 1}, mesh.positions.size());
         }
-        plotter->setData(vertices, indices, normals, colors, textures, texIDs, texture);
-        verticescount = vertices.size();
-        polycount = indices.size();
+        verticescount = mesh.positions.size();
+        polycount = mesh.faceCount();
+        plotter->setData(std::move(mesh));
     }
     else
     {
@@ -65,43 +69,45 @@ MainWindow::MainWindow(QWidget *parent)
 //                         {}, {});
     }
 
-
-    //QThread *thread = new QThread;
-    //plotter->moveToThread(thread);
+    // the plotter and its frame timer live on their own thread, frames come back through a queued signal
+    renderThread = new QThread(this);
+    plotter->moveToThread(renderThread);
 
     // do connections
-    //QObject::connect(thread, &QThread::started, plotter, &Plotter::plot);
     QObject::connect(plotter, &Plotter::plotChanged, this, &MainWindow::plotChanged);
-    //QObject::connect(plotter, &Plotter::cleanup, thread, &QThread::quit);
-    //QObject::connect(thread, &QThread::finished, plotter, &Plotter::deleteLater);
-    //QObject::connect(thread, &QThread::finished, thread, &Plotter::deleteLater);
+    QObject::connect(renderThread, &QThread::finished, plotter, &QObject::deleteLater);
 
-    //thread->start();
+    renderThread->start();
 }
 
 MainWindow::~MainWindow()
 {
+    renderThread->quit();
+    renderThread->wait();
     delete ui;
 }
 
 void MainWindow::paintEvent(QPaintEvent *event)
 {
     //qInfo() << "paint!";
-    auto camera = plotter->getCamera();
+    // the camera belongs to the render thread, show where the frame on screen was taken from
+    const FrameRing::Info info = displayed >= 0 ? plotter->getFrames().info(displayed) : FrameRing::Info{};
 
     QPainter painter(this);
     painter.setPen(QPen(Qt::white, 1));
     painter.setFont(QFont("times",10));
-    painter.drawImage(event->rect(), backbuffer); // will scale and render backbuffer
+    if (displayed >= 0) {
+        painter.drawImage(event->rect(), plotter->getFrames().image(displayed)); // will scale and render the frame
+    }
     painter.drawText(0, 0, 1000, 50, 0, QString::number(drawtime) + "ms; avg "+
                     QString::number(std::accumulate(drawtimes.begin(), drawtimes.end(), 0.0) / 100) +" ms; v " + QString::number(verticescount)
                     + " p " + QString::number(polycount)
-                    + " cam pos x " + QString::number(camera->pos().x()) + " y " + QString::number(camera->pos().y()) + " z " + QString::number(camera->pos().z()));
+                    + " res " + QString::number(info.size.width()) + "x" + QString::number(info.size.height())
+                    + " cam pos x " + QString::number(info.eye.x()) + " y " + QString::number(info.eye.y()) + " z " + QString::number(info.eye.z()));
 }
 
 void MainWindow::keyPressEvent(QKeyEvent *ekey)
 {
-    auto camera = plotter->getCamera();
     // rotate model
     //switch(ekey->key()) {
     //    case Qt::Key_Left: plotter->rotate(-1.0, 0.0); break;
@@ -115,17 +121,56 @@ void MainWindow::keyPressEvent(QKeyEvent *ekey)
     //    case Qt::Key_A: plotter->move(0.0,  -0.1); break;
     //    case Qt::Key_D: plotter->move(0.0,  0.1); break;
     //}
-    // TODO they are called in another thread!!!!!!!
+    // the plotter runs on the render thread, everything goes through its command queue
     switch(ekey->key()) {
-    case Qt::Key_W: camera->moveForward(0.1); break;
-    case Qt::Key_S: camera->moveForward(-0.1); break;
-    case Qt::Key_A: camera->moveSide(-0.1); break;
-    case Qt::Key_D: camera->moveSide(0.1); break;
-    case Qt::Key_Space: camera->moveUp(0.1); break;
-    case Qt::Key_Shift: camera->moveUp(-0.1); break;
-    case Qt::Key_N: plotter->rotate(0.0,  0.0, -1.0); break;
-    case Qt::Key_M: plotter->rotate(0.0,  0.0, 1.0); break;
-    case Qt::Key_P: plotter->togglePause(); break;
+    case Qt::Key_W: post({moveForward, 0.1f}); break;
+    case Qt::Key_S: post({moveForward, -0.1f}); break;
+    case Qt::Key_A: post({moveSide, -0.1f}); break;
+    case Qt::Key_D: post({moveSide, 0.1f}); break;
+    case Qt::Key_Space: post({moveUp, 0.1f}); break;
+    case Qt::Key_Shift: post({moveUp, -0.1f}); break;
+    case Qt::Key_N: post({rotateModel, 0.f, 0.f, -1.f}); break;
+    case Qt::Key_M: post({rotateModel, 0.f, 0.f, 1.f}); break;
+    // commands are only applied by frames, pausing has to reach the plotter thread another way
+    case Qt::Key_P: QMetaObject::invokeMethod(plotter, &Plotter::togglePause, Qt::QueuedConnection); break;
+    case Qt::Key_F:
+        post({[](Plotter &p, const Command &) {
+            p.setShadingMode(p.getShadingMode() == Plotter::ShadingMode::Deferred
+                                 ? Plotter::ShadingMode::Forward
+                                 : Plotter::ShadingMode::Deferred);
+        }});
+        break;
+    case Qt::Key_R:
+        post({[](Plotter &p, const Command &) {
+            p.setRasterMode(p.getRasterMode() == Plotter::RasterMode::HalfSpace
+                                ? Plotter::RasterMode::Scanline
+                                : Plotter::RasterMode::HalfSpace);
+        }});
+        break;
+    case Qt::Key_T:
+        // Reinhard -> ACES -> Uncharted2 -> Reinhard
+        post({[](Plotter &p, const Command &) { p.setTonemap(Tonemap::next(p.getTonemap())); }});
+        break;
+    case Qt::Key_G: post({[](Plotter &p, const Command &) { p.setSrgb(!p.getSrgb()); }}); break;
+    case Qt::Key_B:
+        post({[](Plotter &p, const Command &) {
+            p.setBloomMode(p.getBloomMode() == Bloom::Mode::Pyramid ? Bloom::Mode::Gaussian : Bloom::Mode::Pyramid);
+        }});
+        break;
+    case Qt::Key_V:
+        // target fps -> max throughput -> on demand -> target fps
+        post({[](Plotter &p, const Command &) {
+            p.getScheduler()->setMode(FrameScheduler::next(p.getScheduler()->getMode()));
+        }});
+        break;
+    case Qt::Key_X: post({[](Plotter &p, const Command &) { p.setDynamicResolution(!p.getDynamicResolution()); }}); break;
+    case Qt::Key_H:
+        post({[](Plotter &p, const Command &) {
+            p.setBufferFormat(p.getBufferFormat() == Plotter::BufferFormat::Float16
+                                  ? Plotter::BufferFormat::Float32
+                                  : Plotter::BufferFormat::Float16);
+        }});
+        break;
     }
 
     //plotter->plot();
@@ -133,28 +178,39 @@ void MainWindow::keyPressEvent(QKeyEvent *ekey)
 
 void MainWindow::wheelEvent(QWheelEvent *event)
 {
-    // TODO they are called in another thread!!!!!!!
-    plotter->zoom(event->angleDelta().y() / 1200. + 1.0);
+    post({zoom, float(event->angleDelta().y() / 1200. + 1.0)});
 }
 
 void MainWindow::mousePressEvent(QMouseEvent *event)
 {
-    // TODO they are called in another thread!!!!!!!
     //qInfo() << "press";
-    plotter->getCamera()->reset(event->globalX(), event->globalY());
+    lastMouse = event->globalPos();
 }
 
 void MainWindow::mouseMoveEvent(QMouseEvent *event)
 {
-    // TODO they are called in another thread!!!!!!!
     //qInfo() << "move";
-    plotter->getCamera()->rotate(event->globalX(), event->globalY());
+    // not a command per move, the plotter adds them up until its next frame
+    const QPoint delta = event->globalPos() - lastMouse;
+    lastMouse = event->globalPos();
+    plotter->look(delta.x(), delta.y());
     //plotter->plot();
 }
 
-void MainWindow::plotChanged(QImage p, qint64 t)
+void MainWindow::post(const Plotter::Command &command)
+{
+    // only discrete input goes through the queue, it fills up when the render thread is far behind
+    if (!plotter->post(command)) {
+        qWarning() << "render thread is behind, input dropped";
+    }
+}
+
+void MainWindow::plotChanged(qint64 t)
 {
-    backbuffer = p;
+    // take the newest frame, the one shown until now goes back to the renderer
+    displayed = plotter->getFrames().present();
+    // on demand the scheduler waits for this before it renders the next frame
+    QMetaObject::invokeMethod(plotter->getScheduler(), &FrameScheduler::presented, Qt::QueuedConnection);
     drawtime = t;
     drawtimes[drawtimeTimes++ % 100] = t;
     repaint();
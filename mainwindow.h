@@ -4,6 +4,7 @@
 #include "plotter.h"
 
 #include <QMainWindow>
+#include <QThread>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -25,11 +26,19 @@ protected:
     void mouseMoveEvent(QMouseEvent *event) override;
 
 public Q_SLOTS:
-    void plotChanged(QImage p, qint64 t);
+    void plotChanged(qint64 t);
+
+protected:
+    // to the plotter command queue, warns when it is full
+    void post(const Plotter::Command &command);
 
 protected:
-    QImage backbuffer;
     Plotter *plotter;
+    QThread *renderThread;
+    // frame ring slot on screen, owned by the window until the next present
+    int displayed = -1;
+    // mouse look is sent as the distance from here
+    QPoint lastMouse;
 
     qint64 drawtime;
     qint64 verticescount;
@@ -0,0 +1,43 @@
+#include "mesh.h"
+
+#include <unordered_map>
+
+namespace {
+
+struct CornerKey {
+    int position, normal, uv;
+    bool operator==(const CornerKey &other) const = default;
+};
+
+struct CornerKeyHash {
+    size_t operator()(const CornerKey &k) const
+    {
+        size_t h = std::hash<int>{}(k.position);
+        h ^= std::hash<int>{}(k.normal) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<int>{}(k.uv) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+} // namespace
+
+void Mesh::buildVertexTable()
+{
+    vertexPosition.clear();
+    vertexNormal.clear();
+    vertexUv.clear();
+    cornerVertex.resize(positionIndex.size());
+
+    std::unordered_map<CornerKey, int, CornerKeyHash> vertices;
+    vertices.reserve(positions.size());
+    for (qsizetype k = 0; k < positionIndex.size(); ++k) {
+        const CornerKey key{positionIndex[k], normalIndex[k], uvIndex[k]};
+        auto [it, inserted] = vertices.try_emplace(key, (int)vertexPosition.size());
+        if (inserted) {
+            vertexPosition.append(key.position);
+            vertexNormal.append(key.normal);
+            vertexUv.append(key.uv);
+        }
+        cornerVertex[k] = it->second;
+    }
+}
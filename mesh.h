@@ -0,0 +1,72 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "vec3.h"
+#include "texinfo.h"
+
+#include <QVector>
+
+// vertex attribute stored as separate x, y, z arrays
+struct AttributeArray {
+    QVector<float> x, y, z;
+
+    Math::Vec3 at(qsizetype i) const {return {x[i], y[i], z[i]};}
+    qsizetype size() const {return x.size();}
+    bool isEmpty() const {return x.isEmpty();}
+
+    void append(const Math::Vec3 &v) {
+        x.append(v.x());
+        y.append(v.y());
+        z.append(v.z());
+    }
+    void fill(const Math::Vec3 &v, qsizetype n) {
+        x.fill(v.x(), n);
+        y.fill(v.y(), n);
+        z.fill(v.z(), n);
+    }
+    void reserve(qsizetype n) {
+        x.reserve(n);
+        y.reserve(n);
+        z.reserve(n);
+    }
+};
+
+// packed polygon mesh
+// every face corner has a position, normal and uv index in the flat index buffers,
+// corners of face f are [faceOffsets[f], faceOffsets[f + 1])
+struct Mesh {
+    AttributeArray positions;
+    AttributeArray normals;
+    AttributeArray colors;      // per position
+    AttributeArray uvs;
+    QVector<int> uvTexIds;      // texture of every uv
+
+    QVector<int> positionIndex;
+    QVector<int> normalIndex;
+    QVector<int> uvIndex;
+    QVector<int> faceOffsets{0};
+
+    QVector<TexInfo> textures;
+
+    // unique (position, normal, uv) triples and the one used by every face corner,
+    // filled by buildVertexTable()
+    QVector<int> vertexPosition;
+    QVector<int> vertexNormal;
+    QVector<int> vertexUv;
+    QVector<int> cornerVertex;
+
+    qsizetype faceCount() const {return faceOffsets.size() - 1;}
+    qsizetype vertexCount() const {return vertexPosition.size();}
+
+    void addCorner(int position, int normal, int uv) {
+        positionIndex.append(position);
+        normalIndex.append(normal);
+        uvIndex.append(uv);
+    }
+    // closes the face made of the corners added since the previous call
+    void endFace() {faceOffsets.append(positionIndex.size());}
+
+    void buildVertexTable();
+};
+
+#endif // MESH_H
@@ -1,8 +1,7 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
-#include "vec3.h"
-#include "texinfo.h"
+#include "mesh.h"
 
 #include <QFile>
 #include <QDir>
@@ -10,15 +9,10 @@
 #include <QImage>
 
 
-bool loadOBJ(
+// header only, inline so the app and the tools can both include it
+inline bool loadOBJ(
     QFile objFile,
-    QVector < Math::Vec3 > &out_vertices,
-    QVector < QVector<std::tuple<int, int, int>> > &out_indices, // TODO test
-    QVector < Math::Vec3 > &out_normals,
-    QVector < Math::Vec3 > &out_colors,
-    QVector < Math::Vec3 > &out_textures,
-    QVector < int > &out_texIDs,
-    QVector < TexInfo > &out_texture
+    Mesh &out
     )
 {
     QMap<QString, TexInfo> textures;
@@ -35,13 +29,13 @@ bool loadOBJ(
         auto first = lineParts.at(0);
         if (!first.compare("v", Qt::CaseInsensitive)) {
             // its a vertex
-            out_vertices.append({
+            out.positions.append({
                 lineParts.at(1).toFloat(),
                 lineParts.at(2).toFloat(),
                 lineParts.at(3).toFloat()
             });
             if (lineParts.length() > 4) { // color
-                out_colors.append({
+                out.colors.append({
                     lineParts.at(4).toFloat(),
                     lineParts.at(5).toFloat(),
                     lineParts.at(6).toFloat()
@@ -51,7 +45,7 @@ bool loadOBJ(
         else if (!first.compare("vn", Qt::CaseInsensitive))
         {
             // its a normal
-            out_normals.append({
+            out.normals.append({
                 lineParts.at(1).toFloat(),
                 lineParts.at(2).toFloat(),
                 lineParts.at(3).toFloat()
@@ -61,23 +55,23 @@ bool loadOBJ(
         {
             // its a tex
             switch (lineParts.size()) {
-            case 2: out_textures.append({
+            case 2: out.uvs.append({
                     lineParts.at(1).toFloat(),
                     0,
                     0
                 }); break;
-            case 3: out_textures.append({
+            case 3: out.uvs.append({
                     lineParts.at(1).toFloat(),
                     lineParts.at(2).toFloat(),
                     0
                 }); break;
-            case 4: out_textures.append({
+            case 4: out.uvs.append({
                     lineParts.at(1).toFloat(),
                     lineParts.at(2).toFloat(),
                     lineParts.at(3).toFloat()
                 }); break;
             }
-            out_texIDs.append(texId);
+            out.uvTexIds.append(texId);
         }
         else if (!first.compare("mtllib", Qt::CaseInsensitive))
         {
@@ -152,12 +146,11 @@ bool loadOBJ(
                 //return false;
             }
             texId++;
-            out_texture.append(textures.value(lineParts.at(1)));
+            out.textures.append(textures.value(lineParts.at(1)));
         }
         else if (!first.compare("f", Qt::CaseInsensitive))
         {
             // read faces TODO test
-            QVector<std::tuple<int, int, int>> indexes;
             for (size_t i = 1; i < lineParts.length(); i++) {
                 auto polydata = lineParts.at(i).split('/');
                 int iv = polydata.at(0).toInt() - 1;
@@ -169,9 +162,9 @@ bool loadOBJ(
                 if (polydata.size() >= 2) {
                     in = polydata.at(2).toInt() - 1;
                 }
-                indexes.append(std::make_tuple(iv, in, it));
+                out.addCorner(iv, in, it);
             }
-            out_indices.append(indexes);
+            out.endFace();
 //            if (indexes.length() > 3) {
 //                out_indices.append({indexes[0], indexes[1], indexes[2]});
 //                out_indices.append({indexes[2], indexes[3], indexes[0]});
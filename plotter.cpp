@@ -1,19 +1,27 @@
 #include "plotter.h"
-#include "fast_gaussian_blur_template.h"
+#include "resolve.h"
+#include "simd.h"
 
 #include <QElapsedTimer>
 #include <QDebug>
 
 #include <cmath>
+#include <numeric>
 
 Plotter::Plotter(QSize sz, QObject *parent)
     : QObject{parent}
-    , backbuffer(sz, QImage::Format_RGB32)
+    , batches(polygonBatches)
+    , frames(sz)
     , bloombuffertmp(sz.height() * sz.width() * 3 * 4, 0)
     , bloombuffer(sz.height() * sz.width() * 3 * 4, 0)
     , colorbuffer(sz.height() * sz.width() * 3 * 4, 0)
     , zbuffer(sz.height() * sz.width())
-    , mutexes(sz.height() * sz.width())
+    , hizbuffer(((sz.width() + hizBlock - 1) / hizBlock) * ((sz.height() + hizBlock - 1) / hizBlock))
+    , hizdirty(hizbuffer.size())
+    , hizX((sz.width() + hizBlock - 1) / hizBlock)
+    , gbuffer(sz.height() * sz.width())
+    , bloom(sz)
+    , bloomRadius(bloom.getRadius())
     , clearClr{Qt::black}
     , wireframeClr{"darkorange"}
     , camera{new Camera{0, 0, 2}} // TEMP
@@ -27,58 +35,64 @@ Plotter::Plotter(QSize sz, QObject *parent)
     matRotate.loadIdentity();
     //matTranslate.translate(2, 0, 0);
     move(0, 0, 0);
-    matViewport.viewport(0, 0, sz.width(), sz.height());
     matProjection.perspective((float)sz.width() / (float)sz.height(), 45, 0.1, 100.);
     matUnProjection = matProjection.inversed();
     //matView.view(camera);
     //makeFrustrum();
     makeFrustrum(0.1, 100.); // uses matUnProjection
+    setGuardBand(4.f);
+    setRenderSize(sz);
 
-    timer = new QTimer(this);
-    QObject::connect(timer, &QTimer::timeout, this, &Plotter::plot);
-    togglePause();
+    // renders only when something changed, a child so it moves to the render thread with the plotter
+    scheduler = new FrameScheduler(this);
+    QObject::connect(scheduler, &FrameScheduler::frameDue, this, &Plotter::plot);
 }
 
 void Plotter::togglePause()
 {
     // im running in sep thread
-    static bool paused = true;
-    paused ^= 1;
-    if (paused) {
-        timer->stop();
-    } else {
-        timer->start(1000 / 60); // Start at 60 fps
-    }
+    scheduler->setPaused(!scheduler->isPaused());
 }
 
-void Plotter::setData(QVector<Math::Vec3> data,
-                      QVector<QVector<std::tuple<int, int, int>>> indexes,
-                      QVector<Math::Vec3> normals,
-                      QVector<Math::Vec3> colors,
-                      QVector<Math::Vec3> textures,
-                      QVector < int > texIDs,
-                      QVector<TexInfo> texture)
+bool Plotter::post(const Command &command)
 {
-    this->data.clear();
-    this->data = data;
-
-    this->indexes.clear();
-    this->indexes = indexes;
-
-    this->normals.clear();
-    this->normals = normals;
+    if (!commands.push(command)) return false;
+    requestWake();
+    return true;
+}
 
-    this->colors.clear();
-    this->colors = colors;
+void Plotter::look(int dx, int dy)
+{
+    quint64 delta = lookDelta.load(std::memory_order_relaxed), sum;
+    do {
+        sum = quint64(quint32(qint32(delta >> 32) + dx)) << 32 | quint32(qint32(delta) + dy);
+    } while (!lookDelta.compare_exchange_weak(delta, sum, std::memory_order_release, std::memory_order_relaxed));
+    requestWake();
+}
 
-    this->textures.clear();
-    this->textures = textures;
+void Plotter::requestWake()
+{
+    // one wake up in flight is enough, it sees every command pushed before it runs
+    if (!wakePending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &Plotter::wake, Qt::QueuedConnection);
+    }
+}
 
-    this->texture.clear();
-    this->texture = texture;
+void Plotter::wake()
+{
+    // acquire pairs with the exchange in requestWake, the input given before it is visible
+    wakePending.exchange(false, std::memory_order_acq_rel);
+    // a frame that started in the meantime may have applied it already
+    if (!commands.empty() || lookDelta.load(std::memory_order_relaxed) != 0) {
+        scheduler->invalidate();
+    }
+}
 
-    this->texIDs.clear();
-    this->texIDs = texIDs;
+void Plotter::setData(Mesh mesh)
+{
+    this->mesh = std::move(mesh);
+    this->mesh.buildVertexTable();
+    scheduler->invalidate();
     // precompute normals for model
 //    this->polygons.clear();
 //    for (const auto &ids : qAsConst(indexes)) {
@@ -103,15 +117,10 @@ void Plotter::setData(QVector<Math::Vec3> data,
 
 void Plotter::rotate(float dx, float dy, float dz)
 {
-    static float x_rot = 0.0;
-    static float y_rot = 0.0;
-    static float z_rot = 0.0;
-    x_rot += dx;
-    y_rot += dy;
-    z_rot += dz;
+    modelRotation += {dx, dy, dz};
     Math::Mat4 t1, t2, t3;
-    t1.rotateX(x_rot); t2.rotateY(y_rot);
-    t3.rotateZ(z_rot);
+    t1.rotateX(modelRotation.x()); t2.rotateY(modelRotation.y());
+    t3.rotateZ(modelRotation.z());
     matRotate = t1*t2*t3;
 
     //plot();
@@ -119,29 +128,23 @@ void Plotter::rotate(float dx, float dy, float dz)
 
 void Plotter::move(float dx, float dy, float dz)
 {
-    static float x_mov = 0.0;
-    static float y_mov = 0.0;
-    static float z_mov = 0.0;
-    x_mov += dx;
-    y_mov += dy;
-    z_mov += dz;
-    matTranslate.translate(x_mov, y_mov, z_mov);
+    modelTranslation += {dx, dy, dz};
+    matTranslate.translate(modelTranslation.x(), modelTranslation.y(), modelTranslation.z());
     //plot();
 }
 
 void Plotter::zoom(float factor)
 {
-    static float f = 1.0;
-    f *= factor;
-    matScale.scale(f, f, f);
+    modelScale *= factor;
+    matScale.scale(modelScale, modelScale, modelScale);
     //plot();
 }
 
 void Plotter::drawLines(QVector<Math::Vec3> trData)
 {
-    for (const auto &ids : qAsConst(indexes)) {
-        const auto &a = trData[std::get<0>(ids[0])];
-        const auto &b = trData[std::get<0>(ids[1])];
+    for (qsizetype f = 0; f < mesh.faceCount(); ++f) {
+        const auto &a = trData[mesh.positionIndex[mesh.faceOffsets[f]]];
+        const auto &b = trData[mesh.positionIndex[mesh.faceOffsets[f] + 1]];
 
         // DDA-line
         float x = a[0];
@@ -171,7 +174,7 @@ void Plotter::drawLines(QVector<Math::Vec3> trData)
             // get z
             if (z < zbuffer.at(zindex) && abs(z) < 1) {
                 zbuffer[zindex] = z;
-                backbuffer.setPixelColor(intX, intY, wireframeClr);
+                frames.image(renderSlot).setPixelColor(intX, intY, wireframeClr);
             }
             x += dx;
             y += dy;
@@ -186,13 +189,55 @@ void Plotter::plot()
     //
     //qDebug() << "plot!";
     //
-    QElapsedTimer t;
+    QElapsedTimer t, stage;
     t.start();
-    // clear backbuffer with clear color and zbuffer
-    backbuffer.fill(clearClr);
-    bloombuffertmp.fill(0);
-    colorbuffer.fill(0); // black
-    zbuffer.fill(std::numeric_limits<float>::max());
+    stage.start();
+    // ms since the previous lap
+    const auto lap = [&stage]() {
+        const double ms = stage.nsecsElapsed() / 1e6;
+        stage.start();
+        return ms;
+    };
+    scheduler->frameStarted();
+    // input that arrived since the last frame, all of it before anything reads the camera
+    Command command;
+    bool input = false;
+    while (commands.pop(command)) {
+        command.apply(*this, command);
+        input = true;
+    }
+    // read once, moves that come in while the frame renders go into the next one
+    if (const quint64 delta = lookDelta.exchange(0, std::memory_order_acquire)) {
+        camera->turn(qint32(delta >> 32), qint32(delta));
+        input = true;
+    }
+    if (dynamicResolution) {
+        if (scheduler->isRefinement() && !input) {
+            // nothing moved since the last frame, it is rendered again at the full size
+            renderScale = 1.f;
+            if (sz != frames.size()) setRenderSize(frames.size());
+        } else {
+            updateRenderSize(scheduler->lastCost());
+        }
+    }
+    // target nobody else uses, resolve writes all of its pixels so it is not cleared
+    renderSlot = frames.acquire();
+    QImage &target = frames.image(renderSlot);
+    frames.info(renderSlot).eye = camera->pos();
+    frames.info(renderSlot).size = sz;
+    // zero is all zero bits in both formats, only the part of the planes in use is cleared
+    const int valueSize = bufferFormat == BufferFormat::Float16 ? sizeof(Half) : sizeof(float);
+    // emissive plane is zero outside of what the last bloom wrote
+    for (int y = bloomRect.top(); y <= bloomRect.bottom(); ++y) {
+        char *row = bloombuffertmp.data() + (y * sz.width() + bloomRect.left()) * 3 * valueSize;
+        std::memset(row, 0, bloomRect.width() * 3 * valueSize);
+    }
+    emissiveTiles.fill(0);
+    std::memset(colorbuffer.data(), 0, sz.width() * sz.height() * 3 * valueSize); // black
+    std::fill_n(zbuffer.begin(), sz.width() * sz.height(), std::numeric_limits<float>::max());
+    hizbuffer.fill(std::numeric_limits<float>::max());
+    hizdirty.fill(0);
+    timings.setup = lap();
     // get transform matrix
     // matView = camera->view();
     //qInfo() << camera->view() * matTranslate * matRotate * matScale;
@@ -201,11 +246,22 @@ void Plotter::plot()
     const Math::Mat4 world_mat = matTranslate * matRotate * matScale; // to world cords
     const Math::Mat4 cam_mat = camera->view() * world_mat;
     const Math::Mat4 proj_mat = matViewport * matProjection;
-    // convert points to cam proj
-    QVector<Math::Vec3> trData(data);
-    std::for_each(std::execution::par_unseq, trData.begin(), trData.end(), [cam_mat](auto &p) {
-        p = cam_mat.mul(p);
+    // vertex stage: every unique vertex is transformed once
+    vertexCache.resize(mesh.vertexCount());
+    vertexOutcodes.resize(mesh.vertexCount());
+    std::for_each(std::execution::par_unseq, vertexCache.begin(), vertexCache.end(), [&](Point &p) {
+        const qsizetype i = &p - vertexCache.data();
+        const int iv = mesh.vertexPosition[i], in = mesh.vertexNormal[i], it = mesh.vertexUv[i];
+        const Math::Vec3 v = mesh.positions.at(iv);
+        p = Point(cam_mat.mul(v),
+                  mesh.normals.at(in),
+                  mesh.colors.at(iv),
+                  world_mat.mul(v),
+                  mesh.uvs.at(it),
+                  mesh.uvTexIds[it]);
+        vertexOutcodes[i] = outcode(p.vertex);
     });
+    timings.vertex = lap();
 //    for (auto &p : trData) {
 //        p = cam_mat.mul(p); // todo remove assignment
 //    }
@@ -244,72 +300,330 @@ void Plotter::plot()
 //        });
 //    }
 
-    //par_unseq
-    std::for_each(std::execution::par_unseq, indexes.cbegin(), indexes.cend(), [&](const auto &ids) {
-        //get polygon points
-        QVector<Point> points(ids.size());
-        // TODO tuple logics
-        std::transform(ids.cbegin(), ids.cend(), points.begin(), [&](std::tuple<int, int, int> i){
-            //if (std::get<0>(i) > 33000)
-            //qInfo() << std::get<0>(i) << std::get<1>(i) << trData.length() << colors.length() << normals.length();
-            return Point(trData[std::get<0>(i)],
-                         normals[std::get<1>(i)],
-                         colors[std::get<0>(i)],
-                         world_mat.mul(data[std::get<0>(i)]),
-                         textures[std::get<2>(i)],
-                         texIDs[std::get<2>(i)]);
-        });
-
-        // Discard polygons that are not facing the camera (back-face culling).
-        const float dot = Math::Vec3::dot(
-            Math::Vec3::cross(points[1].vertex, points[2].vertex),
-            points[0].vertex
-        );
-        if (dot > 1e-4f) return;
-
-        // Clip polygon
-        for (const Math::Plane& plane : qAsConst(clippingPlanes))
-            clipPolygon(plane, points);
-        // If the polygon is no longer a surface, don’t try to render it.
-        if (points.size() < 3) return;
-        // Perspective-project remaining points
-        for (auto& p : points)
-        {
-            //auto tmp = p.vertex.z();
-            auto &x = p.vertex;
-            x = proj_mat.mulOrthoDiv(x);
-            //qInfo()<< "b4" << tmp << "af" << p.vertex.z();
+    // geometry: transform, clip and bin polygons into screen tiles
+    std::for_each(std::execution::par_unseq, batches.begin(), batches.end(), [&](RasterBatch &batch) {
+        batch.triangles.clear();
+        batch.gradients.clear();
+        for (auto &bin : batch.bins) bin.clear();
+        // polygons of this batch
+        const qsizetype id = &batch - batches.data();
+        const qsizetype first = mesh.faceCount() * id / polygonBatches;
+        const qsizetype last = mesh.faceCount() * (id + 1) / polygonBatches;
+        // polygon points, stay on the stack for usual polygons
+        ClipPolygon polygons[2];
+        for (qsizetype f = first; f < last; ++f) {
+            //get polygon points
+            auto *points = &polygons[0], *clipped = &polygons[1];
+            points->clear();
+            int andCode = ~0, orCode = 0;
+            for (int k = mesh.faceOffsets[f]; k < mesh.faceOffsets[f + 1]; ++k) {
+                const int v = mesh.cornerVertex[k];
+                points->append(vertexCache[v]);
+                andCode &= vertexOutcodes[v];
+                orCode |= vertexOutcodes[v];
+            }
+            // all corners are outside of the same plane
+            if (andCode & frustumBits) continue;
+            int clipCode = orCode & frustumBits;
+            // inside the guard band the tile scissor does the side clipping, only near and far are left
+            if (clipMode == ClipMode::GuardBand && !(orCode & ~frustumBits)) clipCode &= nearFarBits;
+
+            // Discard polygons that are not facing the camera (back-face culling).
+            const float dot = Math::Vec3::dot(
+                Math::Vec3::cross((*points)[1].vertex, (*points)[2].vertex),
+                (*points)[0].vertex
+            );
+            if (dot > 1e-4f) continue;
+
+            // Clip polygon against the planes some corner is outside of
+            for (int i = 0; clipCode >> i; ++i) {
+                if (!(clipCode & (1 << i))) continue;
+                clipPolygon(clippingPlanes[i], *points, *clipped);
+                std::swap(points, clipped);
+            }
+            // If the polygon is no longer a surface, don’t try to render it.
+            if (points->size() < 3) continue;
+            // Perspective-project remaining points
+            for (auto& p : *points)
+            {
+                //auto tmp = p.vertex.z();
+                auto &x = p.vertex;
+                x = proj_mat.mulOrthoDiv(x);
+                //qInfo()<< "b4" << tmp << "af" << p.vertex.z();
+            }
+            // Tesselate polygon
+            tesselatePolygon(*points, [&](const Point &a, const Point &b, const Point &c) {
+                binTriangle(batch, a, b, c);
+            });
         }
-        // Tesselate polygon
-        tesselatePolygon(points, [&](const Point &a, const Point &b, const Point &c) {
-            //Triangle tr(a, b, c, color);
-            //triangles.push_back(tr);
-            rasterizeTriangle(&a, &b, &c);
-        });
     });
-    // blur (3 channels, 20 sigma, 10 ite)
-    float * p1 = (float *)bloombuffertmp.data();
-    float * p2 = (float *)bloombuffer.data();
-    fast_gaussian_blur(p1, p2,
-        backbuffer.width(), backbuffer.height(), 3, 6, 3
-    );
-    // sum images
-    auto iteb = bloombuffertmp.begin();
-    auto itec = colorbuffer.begin();
-    for (size_t i = 0; i < backbuffer.height(); ++i) {
-        for (size_t j = 0; j < backbuffer.width(); ++j) {
-            Math::Vec3 b(iteb);
-            Math::Vec3 c(itec);
-            c += b;
-            //auto b4 = backbuffer.pixelColor(j, i);
-            backbuffer.setPixelColor(j, i, colorCorrection(c));
-            iteb += 12;
-            itec += 12;
+    timings.geometry = lap();
+    // raster: every tile is owned by one worker, so no locks on zbuffer
+    std::vector<int> tileIds(tiles.size());
+    std::iota(tileIds.begin(), tileIds.end(), 0);
+    std::for_each(std::execution::par_unseq, tileIds.cbegin(), tileIds.cend(), [&](int tile) {
+        rasterizeTile(tile);
+    });
+    timings.raster = lap();
+    // glow of the emissive colors around the tiles that have them, bloombuffer is scratch
+    QRect emissive;
+    for (int tile = 0; tile < tiles.size(); ++tile) {
+        if (emissiveTiles[tile]) emissive |= tiles[tile];
+    }
+    // blur and sum images, tone map and pack into the target, in the format of the planes
+    if (bufferFormat == BufferFormat::Float16) {
+        bloomRect = bloom.apply((Half *)bloombuffertmp.data(), (float *)bloombuffer.data(), emissive);
+        timings.bloom = lap();
+        Resolve::resolve((const Half *)colorbuffer.constData(), (const Half *)bloombuffertmp.constData(), sz, target,
+                         tonemap, srgb);
+    } else {
+        bloomRect = bloom.apply((float *)bloombuffertmp.data(), (float *)bloombuffer.data(), emissive);
+        timings.bloom = lap();
+        Resolve::resolve((const float *)colorbuffer.constData(), (const float *)bloombuffertmp.constData(), sz, target,
+                         tonemap, srgb);
+    }
+    timings.resolve = lap();
+    timings.total = t.nsecsElapsed() / 1e6;
+
+    // hand the frame over to the presenter, no copy of the image
+    frames.publish(renderSlot);
+    renderSlot = -1;
+    emit plotChanged(t.elapsed());
+    // a scaled down frame is not left on screen once things stop moving, the scheduler stays dirty until the full size
+    if (dynamicResolution && sz != frames.size()) {
+        scheduler->refine();
+    }
+    scheduler->frameFinished();
+}
+
+void Plotter::binTriangle(RasterBatch &batch, const Point &a, const Point &b, const Point &c)
+{
+    // rasterizer covers [ceil(min), ceil(max)) on both axes
+    const auto [minx, maxx] = std::minmax({a.vertex.x(), b.vertex.x(), c.vertex.x()});
+    const auto [miny, maxy] = std::minmax({a.vertex.y(), b.vertex.y(), c.vertex.y()});
+    // triangles inside the guard band may reach past the screen, only the scissor is rasterized
+    const int x0 = std::max(scissor.left(), (int)ceil(minx)), x1 = std::min(scissor.right() + 1, (int)ceil(maxx));
+    const int y0 = std::max(scissor.top(), (int)ceil(miny)), y1 = std::min(scissor.bottom() + 1, (int)ceil(maxy));
+    if (x0 >= x1 || y0 >= y1) return;
+
+    const quint32 id = batch.triangles.size();
+    batch.triangles.append(ScreenTriangle{a, b, c});
+    batch.gradients.append(uvGradients(a, b, c));
+    for (int ty = y0 / tileSize; ty <= (y1 - 1) / tileSize; ++ty) {
+        for (int tx = x0 / tileSize; tx <= (x1 - 1) / tileSize; ++tx) {
+            batch.bins[ty * tilesX + tx].push_back(id);
         }
     }
+}
 
-    // notify about buffer change
-    emit plotChanged(backbuffer, t.elapsed());
+void Plotter::rasterizeTile(int tile)
+{
+    const QRect &clip = tiles[tile];
+    if (shadingMode == ShadingMode::Deferred) {
+        for (int y = clip.top(); y <= clip.bottom(); ++y) {
+            std::fill_n(gbuffer.begin() + y * sz.width() + clip.left(), clip.width(), noTriangle);
+        }
+    }
+    // keep submission order: batches in order, triangles in order inside a batch
+    for (quint32 b = 0; b < batches.size(); ++b) {
+        const auto &batch = batches[b];
+        for (const quint32 id : batch.bins[tile]) {
+            const auto &tr = batch.triangles[id];
+            if (triangleOccluded(tr, clip)) continue;
+            if (rasterMode == RasterMode::HalfSpace) {
+                rasterizeTriangleHalfSpace(tr, clip, (b << triangleIdBits) | id, batch.gradients[id]);
+            } else {
+                rasterizeTriangle(&tr[0], &tr[1], &tr[2], clip, (b << triangleIdBits) | id, batch.gradients[id]);
+            }
+        }
+    }
+    if (shadingMode == ShadingMode::Deferred) {
+        shadeTile(clip);
+    }
+}
+
+bool Plotter::triangleOccluded(const ScreenTriangle &tr, const QRect &clip)
+{
+    const auto &a = tr[0].vertex, &b = tr[1].vertex, &c = tr[2].vertex;
+    const int minx = std::max(clip.left(), (int)ceil(std::min({a.x(), b.x(), c.x()})));
+    const int maxx = std::min(clip.right(), (int)ceil(std::max({a.x(), b.x(), c.x()})) - 1);
+    const int miny = std::max(clip.top(), (int)ceil(std::min({a.y(), b.y(), c.y()})));
+    const int maxy = std::min(clip.bottom(), (int)ceil(std::max({a.y(), b.y(), c.y()})) - 1);
+    if (minx > maxx || miny > maxy) return true;
+    // every fragment depth lies between the vertex depths
+    return hizOccluded(minx, miny, maxx, maxy, std::min({a.z(), b.z(), c.z()}));
+}
+
+void Plotter::rasterizeTriangleHalfSpace(const ScreenTriangle &tr, const QRect &clip, quint32 triangle,
+                                         const UvGradients &grad)
+{
+    using Simd::Float;
+    constexpr int block = hizBlock;
+    constexpr int W = Float::width;
+    static_assert(block % W == 0, "block row must be a whole number of vectors");
+
+    const auto &a = tr[0].vertex, &b = tr[1].vertex, &c = tr[2].vertex;
+    // same pixel coverage as the scanline rasterizer: [ceil(min), ceil(max))
+    const int minx = std::max(clip.left(), (int)ceil(std::min({a.x(), b.x(), c.x()})));
+    const int maxx = std::min(clip.right(), (int)ceil(std::max({a.x(), b.x(), c.x()})) - 1);
+    const int miny = std::max(clip.top(), (int)ceil(std::min({a.y(), b.y(), c.y()})));
+    const int maxy = std::min(clip.bottom(), (int)ceil(std::max({a.y(), b.y(), c.y()})) - 1);
+    if (minx > maxx || miny > maxy) return;
+
+    // edge functions e*x + f*y + g, edge i is opposite to vertex i
+    float e[3] = {b.y() - c.y(), c.y() - a.y(), a.y() - b.y()};
+    float f[3] = {c.x() - b.x(), a.x() - c.x(), b.x() - a.x()};
+    // g is taken at the upper end of the edge, so triangles sharing an edge get exactly negated
+    // edge functions even far out in the guard band and no pixel is lost or drawn twice
+    const Math::Vec3 *ends[3][2] = {{&b, &c}, {&c, &a}, {&a, &b}};
+    float g[3];
+    for (int i = 0; i < 3; ++i) {
+        const auto &u = *ends[i][0], &v = *ends[i][1];
+        const auto &o = std::pair(u.y(), u.x()) < std::pair(v.y(), v.x()) ? u : v;
+        g[i] = -(e[i] * o.x() + f[i] * o.y());
+    }
+    float area = e[0] * a.x() + f[0] * a.y() + g[0];
+    if (area == 0.f) return;
+    if (area < 0.f) {
+        // make edge functions positive inside for both windings
+        for (int i = 0; i < 3; ++i) { e[i] = -e[i]; f[i] = -f[i]; g[i] = -g[i]; }
+        area = -area;
+    }
+    // pixels exactly on an edge belong to the triangle on its right or below it,
+    // like [ceil(min), ceil(max)) of the scanline rasterizer
+    bool topLeft[3];
+    for (int i = 0; i < 3; ++i) topLeft[i] = e[i] > 0.f || (e[i] == 0.f && f[i] > 0.f);
+
+    // plane equations of 1/w and attributes over w: pa*x + pb*y + pc
+    // 0 - 1/w, 1..3 - normal, 4..6 - color, 7..9 - pos, 10..11 - tex
+    constexpr int planes = 12;
+    float pa[planes], pb[planes], pc[planes];
+    {
+        float q[3][planes];
+        for (int i = 0; i < 3; ++i) {
+            const Point &p = tr[i];
+            const float iw = 1.f / p.vertex.z(); // z holds w after projection
+            q[i][0] = iw;
+            for (int k = 0; k < 3; ++k) {
+                q[i][1 + k] = p.normal[k] * iw;
+                q[i][4 + k] = p.color[k] * iw;
+                q[i][7 + k] = p.pos[k] * iw;
+            }
+            q[i][10] = p.tex[0] * iw;
+            q[i][11] = p.tex[1] * iw;
+        }
+        const float iarea = 1.f / area;
+        for (int k = 0; k < planes; ++k) {
+            pa[k] = (e[0] * q[0][k] + e[1] * q[1][k] + e[2] * q[2][k]) * iarea;
+            pb[k] = (f[0] * q[0][k] + f[1] * q[1][k] + f[2] * q[2][k]) * iarea;
+            pc[k] = (g[0] * q[0][k] + g[1] * q[1][k] + g[2] * q[2][k]) * iarea;
+        }
+    }
+
+    const int width = sz.width();
+    const bool deferred = shadingMode == ShadingMode::Deferred;
+    const Float ramp = Simd::ramp();
+    const Float es[3] = {Simd::set1(e[0]), Simd::set1(e[1]), Simd::set1(e[2])};
+    const Float zero = Simd::set1(0.f);
+    const Float wa = Simd::set1(pa[0]);
+
+    for (int by = miny & ~(block - 1); by <= maxy; by += block) {
+        for (int bx = minx & ~(block - 1); bx <= maxx; bx += block) {
+            // block rejection: the most inside corner of the block is outside of some edge,
+            // block acceptance: the most outside corner of the block is inside of all edges
+            bool inside = true, outside = false;
+            for (int i = 0; i < 3; ++i) {
+                const float lo = g[i] + e[i] * (e[i] > 0 ? bx : bx + block - 1) + f[i] * (f[i] > 0 ? by : by + block - 1);
+                const float hi = g[i] + e[i] * (e[i] > 0 ? bx + block - 1 : bx) + f[i] * (f[i] > 0 ? by + block - 1 : by);
+                outside |= topLeft[i] ? hi < 0.f : hi <= 0.f;
+                inside &= topLeft[i] ? lo >= 0.f : lo > 0.f;
+            }
+            if (outside) continue;
+
+            // 1/w is linear, so the nearest point of the block is at one of its corners
+            const float iwmax = pc[0] + pa[0] * (pa[0] > 0 ? bx + block - 1 : bx) + pb[0] * (pb[0] > 0 ? by + block - 1 : by);
+            if (iwmax > 0.f && 1.f / iwmax >= hizMax(bx / hizBlock, by / hizBlock)) continue;
+            hizdirty[(by / hizBlock) * hizX + bx / hizBlock] = 1;
+
+            const int y0 = std::max(by, miny), y1 = std::min(by + block - 1, maxy);
+            for (int y = y0; y <= y1; ++y) {
+                const int row = y * width;
+                for (int x = bx; x < bx + block; x += W) {
+                    // lanes inside the bounding box
+                    const int lo = std::clamp(minx - x, 0, W), hi = std::clamp(maxx - x + 1, 0, W);
+                    int mask = (Simd::fullMask >> (W - hi)) & ~((1 << lo) - 1);
+                    if (!mask) continue;
+
+                    const Float xs = Simd::set1(x) + ramp;
+                    if (!inside) {
+                        for (int i = 0; i < 3; ++i) {
+                            const Float d = es[i] * xs + Simd::set1(f[i] * y + g[i]);
+                            mask &= topLeft[i] ? ~Simd::lessMask(d, zero) : Simd::lessMask(zero, d);
+                        }
+                        if (!mask) continue;
+                    }
+
+                    // depth test for all lanes at once
+                    const Float z = Simd::set1(1.f) / (wa * xs + Simd::set1(pb[0] * y + pc[0]));
+                    Float zb;
+                    if (x + W <= width) {
+                        zb = Simd::load(&zbuffer[row + x]);
+                    } else {
+                        float tmp[W];
+                        for (int l = 0; l < W; ++l) tmp[l] = x + l < width ? zbuffer[row + x + l] : 0.f;
+                        zb = Simd::load(tmp);
+                    }
+                    mask &= Simd::lessMask(z, zb);
+                    if (!mask) continue;
+
+                    float zs[W];
+                    Simd::store(zs, z);
+                    if (deferred) {
+                        for (int l = 0; l < W; ++l) {
+                            if (!(mask & (1 << l))) continue;
+                            zbuffer[row + x + l] = zs[l];
+                            gbuffer[row + x + l] = triangle;
+                        }
+                        continue;
+                    }
+
+                    // perspective correct attributes for all lanes at once
+                    float attr[planes][W];
+                    for (int k = 1; k < planes; ++k) {
+                        Simd::store(attr[k], (Simd::set1(pa[k]) * xs + Simd::set1(pb[k] * y + pc[k])) * z);
+                    }
+                    for (int l = 0; l < W; ++l) {
+                        if (!(mask & (1 << l))) continue;
+                        zbuffer[row + x + l] = zs[l];
+                        storePixel(row + x + l, calcPhongColor(Math::Vec3{attr[4][l], attr[5][l], attr[6][l]},
+                                                               Math::Vec3{attr[1][l], attr[2][l], attr[3][l]},
+                                                               Math::Vec3{attr[7][l], attr[8][l], attr[9][l]},
+                                                               Math::Vec3{attr[10][l], attr[11][l], 0},
+                                                               grad.footprint(attr[10][l], attr[11][l], zs[l]),
+                                                               tr[0].texId, x + l, y));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Plotter::shadeTile(const QRect &clip)
+{
+    constexpr quint32 idMask = (1u << triangleIdBits) - 1;
+    for (int y = clip.top(); y <= clip.bottom(); ++y) {
+        for (int x = clip.left(); x <= clip.right(); ++x) {
+            const int zindex = x + y * sz.width();
+            const quint32 triangle = gbuffer[zindex];
+            if (triangle == noTriangle) continue;
+            const auto &batch = batches[triangle >> triangleIdBits];
+            const auto &tr = batch.triangles[triangle & idMask];
+            const Point p = interpolate(tr, x, y);
+            // interpolated z is w of the pixel
+            const float footprint = batch.gradients[triangle & idMask].footprint(p.tex[0], p.tex[1], p.vertex[2]);
+            storePixel(zindex, calcPhongColor(p.color, p.normal, p.pos, p.tex, footprint, p.texId, x, y));
+        }
+    }
 }
 
 void Plotter::makeFrustrum(float znear, float zfar)
@@ -318,10 +632,10 @@ void Plotter::makeFrustrum(float znear, float zfar)
     // TODO why i div on zfar??
     znear *= 1.0001f;
     const std::vector<Math::Vec3> corners {
-        {-0.5f/0.51f, -0.5f/0.51f, zany}, // WHY 0.50001???
-        { 0.5f/0.51f, -0.5f/0.51f, zany},
-        { 0.5f/0.51f,  0.5f/0.51f, zany},
-        {-0.5f/0.51f,  0.5f/0.51f, zany}
+        {-frustumSide, -frustumSide, zany},
+        { frustumSide, -frustumSide, zany},
+        { frustumSide,  frustumSide, zany},
+        {-frustumSide,  frustumSide, zany}
     };
     // znear = near clipping plane distance, zany = arbitrary z value
     //clippingPlanes.clear();
@@ -334,3 +648,105 @@ void Plotter::makeFrustrum(float znear, float zfar)
         clippingPlanes.append({ matUnProjection.mul(*next), matUnProjection.mul(*current), {0,0,0}} );
     }
 }
+
+void Plotter::setRenderSize(QSize size)
+{
+    sz = size;
+    // the projection keeps the aspect of the output, the frame is stretched back to it
+    matViewport.viewport(0, 0, sz.width(), sz.height());
+    hizX = (sz.width() + hizBlock - 1) / hizBlock;
+    // pixels the side planes let through, the same the scanline rasterizer covers: [ceil(min), ceil(max))
+    const float x0 = sz.width() * 0.5f * (1 - frustumSide), x1 = sz.width() * 0.5f * (1 + frustumSide);
+    const float y0 = sz.height() * 0.5f * (1 - frustumSide), y1 = sz.height() * 0.5f * (1 + frustumSide);
+    scissor = QRect(QPoint(ceil(x0), ceil(y0)), QPoint(ceil(x1) - 1, ceil(y1) - 1));
+    // split screen into tiles
+    tiles.clear();
+    tilesX = (sz.width() + tileSize - 1) / tileSize;
+    for (int y = 0; y < sz.height(); y += tileSize) {
+        for (int x = 0; x < sz.width(); x += tileSize) {
+            // side clipping planes are applied by the rasterizer as a scissor in guard band mode
+            tiles.append(QRect(x, y, std::min(tileSize, sz.width() - x), std::min(tileSize, sz.height() - y)).intersected(scissor));
+        }
+    }
+    for (auto &batch : batches) {
+        batch.bins.resize(tiles.size());
+    }
+    emissiveTiles.resize(tiles.size());
+    // the glow covers the same part of the screen at every size
+    bloom.setSize(sz);
+    bloom.setRadius(bloomRadius * sz.width() / frames.size().width());
+    // rows the last bloom wrote do not line up with the new width, the frame start clear only knows bloomRect
+    bloombuffertmp.fill(0);
+    bloomRect = QRect();
+}
+
+void Plotter::updateRenderSize(double cost)
+{
+    if (cost <= 0) return;
+    // frames that end between 80% and 100% of the target keep the size, it would flip between two steps otherwise
+    const double ratio = targetFrameTime / cost;
+    if (ratio >= 1 && ratio < 1.25) return;
+    // pixel work goes with the square of the scale, steps are limited so one slow frame does not halve the size
+    renderScale = std::clamp(float(renderScale * std::clamp(std::sqrt(ratio), 0.8, 1.1)), minRenderScale, 1.f);
+    const QSize output = frames.size();
+    const auto step = [&](int full) {
+        return std::clamp(int(std::lround(full * renderScale / renderSizeStep)) * renderSizeStep, renderSizeStep, full);
+    };
+    const QSize size = renderScale == 1.f ? output : QSize(step(output.width()), step(output.height()));
+    if (size != sz) setRenderSize(size);
+}
+
+void Plotter::setDynamicResolution(bool enabled)
+{
+    dynamicResolution = enabled;
+    if (!enabled && sz != frames.size()) {
+        renderScale = 1.f;
+        setRenderSize(frames.size());
+    }
+}
+
+void Plotter::setBloomRadius(float radius)
+{
+    bloomRadius = radius;
+    bloom.setRadius(bloomRadius * sz.width() / frames.size().width());
+}
+
+void Plotter::setBufferFormat(BufferFormat format)
+{
+    if (format == bufferFormat) return;
+    bufferFormat = format;
+    // rows of the old format do not line up with the new ones, the frame start clear only knows bloomRect
+    bloombuffertmp.fill(0);
+    bloomRect = QRect();
+}
+
+void Plotter::readHdr(float *out) const
+{
+    const qsizetype n = qsizetype(sz.width()) * sz.height() * 3;
+    if (bufferFormat == BufferFormat::Float16) {
+        const Half *color = (const Half *)colorbuffer.constData(), *glow = (const Half *)bloombuffertmp.constData();
+        for (qsizetype i = 0; i < n; ++i) out[i] = toFloat(color[i]) + toFloat(glow[i]);
+    } else {
+        const float *color = (const float *)colorbuffer.constData(), *glow = (const float *)bloombuffertmp.constData();
+        for (qsizetype i = 0; i < n; ++i) out[i] = color[i] + glow[i];
+    }
+}
+
+void Plotter::setGuardBand(float scale)
+{
+    // same side planes as in makeFrustrum, but scale times wider
+    static constexpr float zany = -0.1f;
+    const float side = frustumSide * std::max(scale, 1.f);
+    const std::vector<Math::Vec3> corners {
+        {-side, -side, zany},
+        { side, -side, zany},
+        { side,  side, zany},
+        {-side,  side, zany}
+    };
+    guardPlanes.clear();
+    for(auto begin = corners.begin(), end = corners.end(), current = begin; current != end; ++current)
+    {
+        auto next = std::next(current); if(next == end) next = begin;
+        guardPlanes.append({ matUnProjection.mul(*next), matUnProjection.mul(*current), {0,0,0}} );
+    }
+}
@@ -1,18 +1,26 @@
 #ifndef PLOTTER_H
 #define PLOTTER_H
 
+#include "bloom.h"
 #include "camera.h"
+#include "commandqueue.h"
+#include "framering.h"
+#include "framescheduler.h"
 #include "mat4.h"
+#include "mesh.h"
 #include "texinfo.h"
+#include "tonemap.h"
 #include "plane.h"
 
 #include <QFile>
 #include <QImage>
 #include <QObject>
+#include <QRect>
 #include <QThread>
-#include <QTimer>
+#include <QVarLengthArray>
 #include <QVector>
 
+#include <atomic>
 #include <execution>
 
 class Polygon {
@@ -98,6 +106,8 @@ public:
     }
     float get() const { return begin; }
     void advance()    { begin += step; }
+    void advance(int n) { begin += step * n; }
+    float at(int n) const { return begin + step * n; }
 };
 
 
@@ -111,20 +121,91 @@ public:
 public:
     void togglePause();
 
+    // input from the gui thread, applied by the render thread at the start of the next frame,
+    // apply is a function without captures and x, y, z are its arguments
+    struct Command {
+        void (*apply)(Plotter &plotter, const Command &command) = nullptr;
+        float x = 0, y = 0, z = 0;
+    };
+    // false if the queue is full, the command is dropped then,
+    // wakes the render thread so the scheduler knows the scene changed
+    bool post(const Command &command);
+    // mouse look from the gui thread in pixels, the moves until the next frame add up to one turn
+    // instead of a command each, a fast drag can not fill the queue
+    void look(int dx, int dy);
+    // when frames are rendered, lives on the render thread
+    FrameScheduler *getScheduler() const {return scheduler;};
+
 public:
     // TODO move to sep file
     bool loadFromObj(QFile objFile);
-    void setData(QVector<Math::Vec3> data,
-                 QVector<QVector<std::tuple<int, int, int>>> indexes,
-                 QVector<Math::Vec3> normals,
-                 QVector<Math::Vec3> colors,
-                 QVector<Math::Vec3> textures,
-                 QVector < int > texIDs,
-                 QVector<TexInfo> texture);
+    void setData(Mesh mesh);
     void rotate(float dx, float dy, float dz = 0.0);
     void move(float dx, float dy, float dz);
     void zoom(float factor);
 
+public:
+    // forward shades every rasterized fragment,
+    // deferred resolves visibility first and shades each pixel once
+    enum class ShadingMode {
+        Forward,
+        Deferred,
+    };
+    void setShadingMode(ShadingMode mode) {shadingMode = mode;};
+    ShadingMode getShadingMode() const {return shadingMode;};
+
+    // scanline walks triangle edges with slopes,
+    // half space tests edge functions over 8x8 pixel blocks with SIMD
+    enum class RasterMode {
+        Scanline,
+        HalfSpace,
+    };
+    void setRasterMode(RasterMode mode) {rasterMode = mode;};
+    RasterMode getRasterMode() const {return rasterMode;};
+
+    void setTextureFilter(Texture::Filter filter) {textureFilter = filter;};
+    Texture::Filter getTextureFilter() const {return textureFilter;};
+
+    void setBloomMode(Bloom::Mode mode) {bloom.setMode(mode);};
+    Bloom::Mode getBloomMode() const {return bloom.getMode();};
+    // in output pixels, scaled with the render size
+    void setBloomRadius(float radius);
+    void setBloomThreshold(float threshold) {bloom.setThreshold(threshold);};
+
+    // storage of the hdr color and emissive planes, half precision halves the bandwidth of bloom and resolve
+    enum class BufferFormat {
+        Float32,
+        Float16,
+    };
+    void setBufferFormat(BufferFormat format);
+    BufferFormat getBufferFormat() const {return bufferFormat;};
+
+    void setTonemap(Tonemap::Operator op) {tonemap = op;};
+    Tonemap::Operator getTonemap() const {return tonemap;};
+    // srgb encoding of the tone mapped color
+    void setSrgb(bool enabled) {srgb = enabled;};
+    bool getSrgb() const {return srgb;};
+
+    // frustum clips polygons against all six planes,
+    // guard band clips only near and far while the polygon stays inside the guard band
+    // and leaves the sides to the rasterizer scissor
+    enum class ClipMode {
+        Frustum,
+        GuardBand,
+    };
+    void setClipMode(ClipMode mode) {clipMode = mode;};
+    ClipMode getClipMode() const {return clipMode;};
+    // guard band size relative to the viewport
+    void setGuardBand(float scale);
+
+    // dynamic resolution: every frame the render size moves towards the one that takes targetFrameTime ms,
+    // between minRenderScale and the output size, the resolve scales the frame up to the output size
+    void setDynamicResolution(bool enabled);
+    bool getDynamicResolution() const {return dynamicResolution;};
+    void setTargetFrameTime(float ms) {targetFrameTime = ms;};
+    float getTargetFrameTime() const {return targetFrameTime;};
+    QSize getRenderSize() const {return sz;};
+
 public:
     SharedCamera getCamera() const {return camera;};
 
@@ -134,70 +215,32 @@ protected:
 
 protected:
 
-    QColor colorCorrection(const Math::Vec3 &clr) {
-        float x = clr.x();
-        float y = clr.y();
-        float z = clr.z();
-
-        // tone mapping
-                x = x / (1+x);
-                y = y / (1+y); // формула Рейнхарда
-                z = z / (1+z);
-//        float a = 2.51f;
-//        float b = 0.03f;
-//        float c = 2.43f;
-//        float d = 0.59f;
-//        float e = 0.14f;
-//        x = std::clamp((x * (a*x + b)) / (x * (c * x + d) + e), 0.f, 1.f);
-//        y = std::clamp((y * (a*y + b)) / (y * (c * y + d) + e), 0.f, 1.f);
-//        z = std::clamp((z * (a*z + b)) / (z * (c * z + d) + e), 0.f, 1.f);
-        // gamma correction
-        //x = pow(x, 1/ 2.2);
-        //y = pow(y, 1/ 2.2);
-        //z = pow(z, 1/ 2.2);
-        return QColor (x * 255,
-                y * 255,
-                z * 255);
-    }
-
     std::pair<Math::Vec3, Math::Vec3> calcPhongColor(Math::Vec3 color,
                           Math::Vec3 normal,
                           Math::Vec3 pos,
-                          Math::Vec3 tex,
+                          Math::Vec3 tex, float footprint,
                           int texId, int px, int py) {
         //qInfo() << "tex " << tex.z() << pos.z();
-        auto &curTexBump = texture[texId].tBump;
-        auto &curTexDiffuse = texture[texId].tDiffuse;
-        auto &curTexNormal = texture[texId].tNormal;
-        auto &curTexBloom = texture[texId].tBloom;
+        auto &curTexBump = mesh.textures[texId].tBump;
+        auto &curTexDiffuse = mesh.textures[texId].tDiffuse;
+        auto &curTexNormal = mesh.textures[texId].tNormal;
+        auto &curTexBloom = mesh.textures[texId].tBloom;
 
-        Math::Vec3 texClr = texture[texId].tColor;
+        Math::Vec3 texClr = mesh.textures[texId].tColor;
         if (!curTexDiffuse.isNull()) {
-            auto w = curTexDiffuse.width()-1, h = curTexDiffuse.height()-1;
-            auto tx = (int)((tex.x()) * (w)) % w;
-            auto ty = ((16*h-1) + (int)((-tex.y() * h))) % h;
-            texClr = curTexDiffuse.pixelColor(tx, ty);
+            texClr = curTexDiffuse.sample(tex.x(), tex.y(), footprint, textureFilter);
         }
         Math::Vec3 texBloom(0.0, 0.0, 0.0);
         if (!curTexBloom.isNull()) {
-            auto w = curTexBloom.width(), h = curTexBloom.height();
-            auto tx = (int)((tex.x()) * (w)) % w;
-            auto ty = ((16*h-1) + (int)((-tex.y() * h))) % h;
-            texBloom = curTexBloom.pixelColor(tx, ty);
+            texBloom = curTexBloom.sample(tex.x(), tex.y(), footprint, textureFilter);
         }
         float kSpecularT = kSpecular;
 //        if (!curTexBump.isNull()) {
-//            auto w = curTexBump.width(), h = curTexBump.height();
-//            auto tx = (int)((tex.x()) * (w)) % w;
-//            auto ty = ((16*h-1) + (int)((-tex.y()) * (h))) % h;
-//            kSpecularT = curTexBump.pixelColor(tx, ty).redF();
+//            kSpecularT = curTexBump.sample(tex.x(), tex.y(), footprint, textureFilter).x();
 //        }
         normal = normal.normalized();
         if (!curTexNormal.isNull()) {
-            auto w = curTexNormal.width(), h = curTexNormal.height();
-            auto tx = (int)((tex.x()) * (w)) % w;
-            auto ty = ((8*h-1) + (int)((-tex.y()) * (h))) % h;
-            auto n = Math::Vec3(curTexNormal.pixelColor(tx, ty));
+            auto n = curTexNormal.sample(tex.x(), tex.y(), footprint, textureFilter);
             normal[0] += n.x() * 2 - 1.0f;
             normal[1] += n.y() * 2 - 1.0f;
             normal[2] += n.z() * 2 - 1.0f;
@@ -232,13 +275,53 @@ protected:
         //
         // if (x < 0 || x >= sz.width() || y < 0  || y >= sz.height()) return;
         // Draw pixel algorithm
+        // no lock needed: every pixel belongs to exactly one tile and every tile to one worker
         const int zindex = x + y * sz.width();
 
-        std::unique_lock l(mutexes.at(zindex));
         // get z
         if (z < zbuffer.at(zindex)) {
             zbuffer[zindex] = z;
+            hizdirty[(y / hizBlock) * hizX + x / hizBlock] = 1;
             //backbuffer.setPixelColor(x, y, color);
+            storePixel(zindex, color);
+        }
+
+    }
+    // max depth of the hi-z block, recomputed from zbuffer only if it was written since the last query
+    float hizMax(int bx, int by) {
+        const int index = by * hizX + bx;
+        if (hizdirty[index]) {
+            float m = 0.f;
+            const int x0 = bx * hizBlock, x1 = std::min(x0 + hizBlock, sz.width());
+            const int y0 = by * hizBlock, y1 = std::min(y0 + hizBlock, sz.height());
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    m = std::max(m, zbuffer[y * sz.width() + x]);
+                }
+            }
+            hizbuffer[index] = m;
+            hizdirty[index] = 0;
+        }
+        return hizbuffer[index];
+    }
+    // true if nothing at depth >= zmin can pass the depth test in the pixel rect [x0, x1] x [y0, y1]
+    bool hizOccluded(int x0, int y0, int x1, int y1, float zmin) {
+        for (int by = y0 / hizBlock; by <= y1 / hizBlock; ++by) {
+            for (int bx = x0 / hizBlock; bx <= x1 / hizBlock; ++bx) {
+                if (zmin < hizMax(bx, by)) return false;
+            }
+        }
+        return true;
+    }
+    void storePixel(int zindex, const std::pair<Math::Vec3, Math::Vec3> &color) {
+        if (bufferFormat == BufferFormat::Float16) {
+            auto posclr = (Half *)(colorbuffer.data()) + zindex * 3;
+            auto posbloom = (Half *)(bloombuffertmp.data()) + zindex * 3;
+            for (int k = 0; k < 3; ++k) {
+                posclr[k] = toHalf(color.first[k]);
+                posbloom[k] = toHalf(color.second[k]);
+            }
+        } else {
             auto posclr = (float *)(colorbuffer.data()) + zindex * 3;
             auto posbloom = (float *)(bloombuffertmp.data()) + zindex * 3;
             std::memcpy(posclr, color.first.data(), 4*3);
@@ -250,13 +333,54 @@ protected:
                 //std::memset(posbloom, 0, 4*3);
             //}
         }
-
+        // only tiles with emission are blurred, the tile belongs to the calling worker
+        if (color.second.x() != 0.f || color.second.y() != 0.f || color.second.z() != 0.f) {
+            const int y = zindex / sz.width(), x = zindex - y * sz.width();
+            emissiveTiles[(y / tileSize) * tilesX + x / tileSize] = 1;
+        }
     }
 
     void makeFrustrum(float znear, float zfar);
+    // everything that depends on the render size, the planes are allocated for the output size and used from the front
+    void setRenderSize(QSize size);
+    // dynamic resolution step after a frame that took cost ms
+    void updateRenderSize(double cost);
 
     static constexpr size_t slopeDataSz = 13;
     using SlopeData = std::array<Slope, slopeDataSz>;
+
+    // screen space gradients of 1/w, u/w and v/w over a triangle, mip levels are picked from them
+    struct UvGradients {
+        float dx[3], dy[3];
+
+        // uv distance to the neighbour pixels at a point with uv (u, v) and depth w
+        float footprint(float u, float v, float w) const
+        {
+            const float dudx = (dx[1] - u * dx[0]) * w, dvdx = (dx[2] - v * dx[0]) * w;
+            const float dudy = (dy[1] - u * dy[0]) * w, dvdy = (dy[2] - v * dy[0]) * w;
+            return sqrtf(std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy));
+        }
+    };
+    static UvGradients uvGradients(const Point &a, const Point &b, const Point &c)
+    {
+        const auto &va = a.vertex, &vb = b.vertex, &vc = c.vertex;
+        const float e[3] = {vb.y() - vc.y(), vc.y() - va.y(), va.y() - vb.y()};
+        const float f[3] = {vc.x() - vb.x(), va.x() - vc.x(), vb.x() - va.x()};
+        const float area = e[0] * (va.x() - vb.x()) + f[0] * (va.y() - vb.y());
+        UvGradients grad{};
+        if (area == 0.f) return grad;
+        const Point *p[3] = {&a, &b, &c};
+        for (int i = 0; i < 3; ++i) {
+            // z holds w after projection
+            const float iw = 1.f / p[i]->vertex.z() / area;
+            const float q[3] = {iw, p[i]->tex[0] * iw, p[i]->tex[1] * iw};
+            for (int k = 0; k < 3; ++k) {
+                grad.dx[k] += e[i] * q[k];
+                grad.dy[k] += f[i] * q[k];
+            }
+        }
+        return grad;
+    }
     SlopeData makeSlope(const Point *from, const Point *to, int num_steps ) const {
         SlopeData result;
         // X coords
@@ -303,7 +427,8 @@ protected:
         result[12] = Slope( b * zbegin, e * zend, num_steps );
         return result;
     }
-    void drawScanLine(float y, SlopeData &left, SlopeData &right, int texId = 0) {
+    void drawScanLine(float y, SlopeData &left, SlopeData &right, const QRect &clip, quint32 triangle,
+                      const UvGradients &grad, int texId = 0) {
         // Number of steps = number of pixels on this scanline = endx-x
         int x = ceil(left[0].get()), endx = ceil(right[0].get()); // TODO
 
@@ -313,6 +438,34 @@ protected:
         {
             props[p] = Slope( left[p + 1].get(), right[p + 1].get(), endx-x );
         }
+        // cut the span to the tile
+        if (x < clip.left()) {
+            for (auto &slope : props) slope.advance(clip.left() - x);
+            x = clip.left();
+        }
+        endx = std::min(endx, clip.right() + 1);
+
+        // z is monotonic along the span, skip it if its nearest end is behind everything drawn there
+        if (x < endx && hizOccluded(x, y, endx - 1, y, std::min(1.f / props[0].get(), 1.f / props[0].at(endx - 1 - x)))) {
+            x = endx;
+        }
+
+        if (shadingMode == ShadingMode::Deferred) {
+            // visibility only: depth and triangle id, shading happens once per pixel later
+            const int row = y * sz.width();
+            for (; x < endx; ++x) {
+                const float z = 1.f / props[0].get();
+                if (z < zbuffer[row + x]) {
+                    zbuffer[row + x] = z;
+                    gbuffer[row + x] = triangle;
+                    hizdirty[((int)y / hizBlock) * hizX + x / hizBlock] = 1;
+                }
+                props[0].advance();
+            }
+            for(auto& slope: left) slope.advance();
+            for(auto& slope: right) slope.advance();
+            return;
+        }
 
         for (; x < endx; ++x) {
             float invz = props[0].get();
@@ -322,7 +475,8 @@ protected:
             plotPixel(x, y, z, calcPhongColor(Math::Vec3{props[4].get()*z, props[5].get()*z, props[6].get()*z},
                                               Math::Vec3{props[1].get()*z, props[2].get()*z, props[3].get()*z},
                                               Math::Vec3{props[7].get()*z, props[8].get()*z, props[9].get()*z},
-                                              Math::Vec3{props[10].get()*z, props[11].get()*z, 0}, texId, x, y));
+                                              Math::Vec3{props[10].get()*z, props[11].get()*z, 0},
+                                              grad.footprint(props[10].get()*z, props[11].get()*z, z), texId, x, y));
             // After each pixel, update the props by their step-sizes
             for (auto &slope : props) slope.advance();
         }
@@ -333,7 +487,9 @@ protected:
         //for (auto &slope : right) slope.advance();
     }
     // + color
-    void rasterizeTriangle(const Point *p0, const Point *p1, const Point *p2)
+    // only pixels inside clip are drawn (clip is the tile being rasterized)
+    void rasterizeTriangle(const Point *p0, const Point *p1, const Point *p2, const QRect &clip, quint32 triangle,
+                           const UvGradients &grad)
     {
         // top-bottom rasterization
         auto [x0, y0, x1, y1, x2, y2] = std::tuple(
@@ -379,26 +535,66 @@ protected:
                     endy = y2;
                 }
             }
-            drawScanLine(y, sides[0], sides[1], p0->texId); // TODO costil to store tex id
+            if (y < clip.top()) {
+                // skip scanlines above the tile at once
+                const int skip = std::min(endy, (float)clip.top()) - y;
+                for (auto &slope : sides[0]) slope.advance(skip);
+                for (auto &slope : sides[1]) slope.advance(skip);
+                y += skip - 1;
+                continue;
+            }
+            if (y > clip.bottom()) break;
+            drawScanLine(y, sides[0], sides[1], clip, triangle, grad, p0->texId); // TODO costil to store tex id
         }
     }
 
-    void clipPolygon(const Math::Plane& p, auto &points) const
+    // perspective correct attributes of the triangle at screen point x, y
+    Point interpolate(const std::array<Point, 3> &tr, float x, float y) const
     {
-        bool keepfirst = true;
+        const auto &a = tr[0].vertex, &b = tr[1].vertex, &c = tr[2].vertex;
+        // barycentric weights from edge functions
+        const float area = (c.x() - b.x()) * (a.y() - b.y()) - (c.y() - b.y()) * (a.x() - b.x());
+        if (area == 0.f) return tr[0];
+        const float la = ((c.x() - b.x()) * (y - b.y()) - (c.y() - b.y()) * (x - b.x())) / area;
+        const float lb = ((a.x() - c.x()) * (y - c.y()) - (a.y() - c.y()) * (x - c.x())) / area;
+        const float lc = 1.f - la - lb;
+        // z holds w after projection, attributes are linear in 1/w
+        const float qa = la / a.z(), qb = lb / b.z(), qc = lc / c.z();
+        Point p = (tr[0] * qa + tr[1] * qb + tr[2] * qc) * (1.f / (qa + qb + qc));
+        p.texId = tr[0].texId;
+        return p;
+    }
 
+    // bit i is set when the point is outside of clipping plane i,
+    // bits above frustumBits are set when it is outside of the guard band
+    int outcode(const Math::Vec3 &v) const
+    {
+        int code = 0;
+        for (int i = 0; i < clippingPlanes.size(); ++i) {
+            if (clippingPlanes[i].distanceTo(v) < 0) code |= 1 << i;
+        }
+        if (clipMode == ClipMode::GuardBand) {
+            for (int i = 0; i < guardPlanes.size(); ++i) {
+                if (guardPlanes[i].distanceTo(v) < 0) code |= 1 << (clippingPlanes.size() + i);
+            }
+        }
+        return code;
+    }
+    // Sutherland-Hodgman: writes the part of polygon in that is inside the plane to out
+    void clipPolygon(const Math::Plane& p, const auto &in, auto &out) const
+    {
+        out.clear();
+        if (in.isEmpty()) return;
+        float outside = p.distanceTo(in[0].vertex);
         // Process each edge of the polygon (line segment between two successive points)
-        for(auto current = points.begin(); current != points.end(); )
+        for (qsizetype i = 0; i < in.size(); ++i)
         {
-            auto next = std::next(current);
-            if(next == points.end()) { next = points.begin(); }
+            const auto &current = in[i];
+            const auto &next = in[i + 1 == in.size() ? 0 : i + 1];
+            const float outsidenext = p.distanceTo(next.vertex);
 
-            auto outside     = p.distanceTo(current->vertex);
-            auto outsidenext = p.distanceTo(next->vertex);
-
-            // If this corner is not inside the plane, keep it
-            bool keep = outside >= 0;
-            if(current == points.begin()) { keepfirst=keep; keep=true; }
+            // If this corner is not inside the plane, drop it
+            if (outside >= 0) out.append(current);
 
             // If this edge of the polygon _crosses_ the plane, generate an intersection point
             if((outside < 0 && outsidenext > 0)
@@ -406,22 +602,11 @@ protected:
             {
                 auto factor = outside / (outside - outsidenext);
 
-                // Create a new point b between *current and *next like this: current + (next-current) * factor
-                auto b = *current + ((*next - *current) * factor);
-
-                if(keep) { current = std::next(points.insert(std::next(current), std::move(b))); }
-                else     { *current = std::move(b); ++current; }
-            }
-            else
-            {
-                // Keep or delete the original vertex
-                if(keep)
-                    ++current;
-                else
-                    current = points.erase(current);
+                // Create a new point b between current and next like this: current + (next-current) * factor
+                out.append(current + ((next - current) * factor));
             }
+            outside = outsidenext;
         }
-        if(!keepfirst) points.erase(points.begin());
     }
     void tesselatePolygon(auto& points, auto && pushTriangle) const
         requires std::ranges::random_access_range<decltype(points)>
@@ -488,13 +673,72 @@ protected:
     }
 
 protected:
+    // near, far, then the four side planes
     QVector<Math::Plane> clippingPlanes;
+    static constexpr int nearFarBits = 0b000011;
+    static constexpr int frustumBits = 0b111111;
+    // side planes are at this NDC coordinate
+    static constexpr float frustumSide = 0.5f/0.51f; // WHY 0.50001???
+    QVector<Math::Plane> guardPlanes;
+    // pixels inside the side planes
+    QRect scissor;
+    ClipMode clipMode = ClipMode::GuardBand;
+
+protected:
+    // screen is split into tiles, each tile is rasterized by a single worker without locks
+    static constexpr int tileSize = 64;
+    // polygons are processed in a fixed number of batches, so the draw order does not depend on threads count
+    static constexpr int polygonBatches = 128;
+
+    using ScreenTriangle = std::array<Point, 3>;
+    struct RasterBatch {
+        // triangles produced by the polygons of this batch
+        QVector<ScreenTriangle> triangles;
+        QVector<UvGradients> gradients;
+        // ids of triangles overlapping each tile
+        std::vector<std::vector<quint32>> bins;
+    };
+
+    void binTriangle(RasterBatch &batch, const Point &a, const Point &b, const Point &c);
+    void rasterizeTile(int tile);
+    bool triangleOccluded(const ScreenTriangle &tr, const QRect &clip);
+    void rasterizeTriangleHalfSpace(const ScreenTriangle &tr, const QRect &clip, quint32 triangle,
+                                    const UvGradients &grad);
+    void shadeTile(const QRect &clip);
+
+    // g-buffer triangle reference: batch in the high bits, triangle id inside the batch in the low bits
+    static constexpr int triangleIdBits = 24;
+    static constexpr quint32 noTriangle = ~0u;
+    static_assert(polygonBatches < (1 << (32 - triangleIdBits)), "batch does not fit the triangle reference");
+
+    QVector<QRect> tiles;
+    int tilesX = 0;
+    std::vector<RasterBatch> batches;
 
 public Q_SLOTS:
     void plot();
 
+public:
+    // finished frames, the presenter takes them with present() after plotChanged
+    FrameRing &getFrames() {return frames;};
+    // ms spent in every stage of the last frame
+    struct FrameTimings {
+        double setup = 0;    // input, render size, clearing the planes
+        double vertex = 0;
+        double geometry = 0; // clipping, binning into tiles
+        double raster = 0;   // rasterization and shading of the tiles
+        double bloom = 0;
+        double resolve = 0;
+        double total = 0;
+    };
+    const FrameTimings &getTimings() const {return timings;};
+    // color + glow of the last frame before tone mapping, interleaved rgb of getRenderSize(),
+    // valid until the next frame starts
+    void readHdr(float *out) const;
+
 Q_SIGNALS:
-    void plotChanged(QImage p, qint64 t);
+    // a new frame is ready in the frame ring, t is its render time in ms
+    void plotChanged(qint64 t);
     void cleanup();
 
 protected:
@@ -511,13 +755,45 @@ protected:
 
 protected:
     QSize sz;
-    QImage backbuffer;
+    FrameRing frames;
+    // target of the frame being rendered
+    int renderSlot = -1;
+    // gui thread -> render thread
+    CommandQueue<Command, 256> commands;
     //QImage bloombuffer;
+    // color and emissive planes in bufferFormat, allocated for float so the format can change,
+    // bloombuffer is float scratch of the blur
     QByteArray bloombuffertmp;
     QByteArray bloombuffer;
     QByteArray colorbuffer;
     QVector<float> zbuffer;
-    std::vector<std::mutex> mutexes;
+    // hierarchical z: max depth of every hizBlock x hizBlock pixels, kept lazily up to date with dirty flags
+    static constexpr int hizBlock = 8;
+    static_assert(tileSize % hizBlock == 0, "hi-z blocks must not cross tiles");
+    QVector<float> hizbuffer;
+    QVector<quint8> hizdirty;
+    int hizX = 0;
+    QVector<quint32> gbuffer; // triangle visible at the pixel, attributes and texId are taken from it
+    Bloom bloom;
+    // tiles that got a non zero emissive color this frame
+    QVector<quint8> emissiveTiles;
+    // part of bloombuffertmp the last bloom pass wrote, the rest is zero
+    QRect bloomRect;
+    ShadingMode shadingMode = ShadingMode::Deferred;
+    RasterMode rasterMode = RasterMode::Scanline;
+    Texture::Filter textureFilter = Texture::Filter::Trilinear;
+    Tonemap::Operator tonemap = Tonemap::Operator::Reinhard;
+    bool srgb = false;
+    BufferFormat bufferFormat = BufferFormat::Float32;
+    float bloomRadius;
+    FrameTimings timings;
+    // render sizes are multiples of the hi-z block, so blocks and SIMD rows never hang over the edge
+    static constexpr int renderSizeStep = hizBlock;
+    static constexpr float minRenderScale = 0.25f;
+    bool dynamicResolution = false;
+    float targetFrameTime = 1000.f / 60;
+    // wanted size relative to the output size, sz is it rounded to renderSizeStep
+    float renderScale = 1.f;
     QColor clearClr;
     QColor wireframeClr;
 
@@ -525,18 +801,20 @@ protected:
     SharedCamera camera;
 
 protected:
-    QVector<Math::Vec3> data;
-    QVector<Math::Vec3> normals;
+    Mesh mesh;
     QVector<Polygon> polygons;
     QVector<Triangle> triangles;
-    QVector<Math::Vec3> textures;
-
-    QVector<QVector<std::tuple<int, int, int>>> indexes;
-    QVector<Math::Vec3> colors;
-
-    QVector<TexInfo> texture;
-    QVector < int > texIDs;
-
+    // every unique mesh vertex transformed once per frame, faces gather their corners from it
+    QVector<Point> vertexCache;
+    QVector<quint16> vertexOutcodes;
+    // clipping ping-pongs between two of these, every plane adds at most one corner
+    static constexpr int clipCorners = 32;
+    using ClipPolygon = QVarLengthArray<Point, clipCorners>;
+
+    // model transform the matrices are built from, per plotter so every instance starts from the same one
+    float modelScale = 1.f;
+    Math::Vec3 modelRotation{0, 0, 0};
+    Math::Vec3 modelTranslation{0, 0, 0};
     Math::Mat4 matScale;
     Math::Mat4 matRotate;
     Math::Mat4 matTranslate;
@@ -547,7 +825,13 @@ protected:
     Math::Mat4 matUnProjection;
 
 protected:
-    QTimer *timer;
+    FrameScheduler *scheduler;
+    // a wake up for posted commands is on its way to the render thread
+    std::atomic<bool> wakePending{false};
+    // look pixels not applied yet, x in the high half and y in the low half
+    std::atomic<quint64> lookDelta{0};
+    void requestWake();
+    void wake();
 };
 
 #endif // PLOTTER_H
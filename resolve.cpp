@@ -0,0 +1,206 @@
+#include "resolve.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace Resolve {
+
+namespace {
+
+// rows resolved by one worker
+constexpr int bandRows = 16;
+
+// tone maps W channels of float or half planes, without srgb they are truncated to 8 bit,
+// with srgb they are quantized to the index of the srgb table
+template<class Op, bool Srgb, typename T>
+inline void tonemap(const T *color, const T *bloom, std::int32_t *out)
+{
+    using Simd::Float;
+    const Float c = Simd::max(Simd::load(color) + Simd::load(bloom), Simd::set1(0.f));
+    // min also turns nan from inf / inf into 1
+    const Float t = Simd::min(Op::apply(c), Simd::set1(1.f));
+    if constexpr (Srgb) {
+        Simd::storeTruncated(out, t * Simd::set1(Tonemap::srgbLutSize - 1) + Simd::set1(0.5f));
+    } else {
+        Simd::storeTruncated(out, t * Simd::set1(255.f));
+    }
+}
+
+// one row of width pixels, tmp holds width * 3 channels
+template<class Op, bool Srgb, typename T>
+void resolveRow(const T *color, const T *bloom, quint32 *out, int width, std::int32_t *tmp)
+{
+    constexpr int W = Simd::Float::width;
+    const int n = width * 3;
+    // channels are independent, tone map them as a flat float array
+    int i = 0;
+    for (; i + W <= n; i += W) {
+        tonemap<Op, Srgb, T>(color + i, bloom + i, tmp + i);
+    }
+    if (i < n) {
+        // the tail goes through the same kernel, padded with zeros
+        T c[W] = {}, b[W] = {};
+        std::int32_t t[W];
+        std::copy(color + i, color + n, c);
+        std::copy(bloom + i, bloom + n, b);
+        tonemap<Op, Srgb, T>(c, b, t);
+        std::copy(t, t + (n - i), tmp + i);
+    }
+    if constexpr (Srgb) {
+        const auto &lut = Tonemap::srgbLut();
+        for (int x = 0; x < width; ++x) {
+            out[x] = 0xff000000u | quint32(lut[tmp[3 * x]]) << 16 | quint32(lut[tmp[3 * x + 1]]) << 8 | lut[tmp[3 * x + 2]];
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            out[x] = 0xff000000u | quint32(tmp[3 * x]) << 16 | quint32(tmp[3 * x + 1]) << 8 | quint32(tmp[3 * x + 2]);
+        }
+    }
+}
+
+template<class Op, bool Srgb, typename T>
+void resolveImage(const T *color, const T *bloom, QImage &target)
+{
+    const int width = target.width(), height = target.height();
+    // bits() detaches the image once here, not in every worker
+    uchar *bits = target.bits();
+    const qsizetype stride = target.bytesPerLine();
+
+    std::vector<int> bands((height + bandRows - 1) / bandRows);
+    std::iota(bands.begin(), bands.end(), 0);
+    std::for_each(std::execution::par_unseq, bands.cbegin(), bands.cend(), [&](int band) {
+        std::vector<std::int32_t> tmp(width * 3);
+        const int y1 = std::min(height, (band + 1) * bandRows);
+        for (int y = band * bandRows; y < y1; ++y) {
+            const qsizetype offset = qsizetype(y) * width * 3;
+            resolveRow<Op, Srgb, T>(color + offset, bloom + offset,
+                                    reinterpret_cast<quint32 *>(bits + y * stride), width, tmp.data());
+        }
+    });
+}
+
+// bilinear taps of one target coordinate, pixel centers of both grids line up
+struct Tap {
+    int i0, i1;
+    float f;
+};
+
+std::vector<Tap> taps(int from, int to)
+{
+    std::vector<Tap> t(to);
+    const float scale = float(from) / to;
+    for (int i = 0; i < to; ++i) {
+        const float s = std::clamp((i + 0.5f) * scale - 0.5f, 0.f, float(from - 1));
+        const int i0 = int(s);
+        t[i] = {i0, std::min(i0 + 1, from - 1), s - i0};
+    }
+    return t;
+}
+
+// color + bloom of one plane row of width pixels, resampled to the target columns in xs,
+// sum and tmp hold width * 3 channels
+template<typename T>
+void scaleRow(const T *color, const T *bloom, int width, const std::vector<Tap> &xs, float *sum, float *tmp, float *out)
+{
+    const int n = width * 3;
+    if constexpr (std::is_same_v<T, Half>) {
+        Simd::convert(color, sum, n);
+        Simd::convert(bloom, tmp, n);
+        for (int i = 0; i < n; ++i) sum[i] += tmp[i];
+    } else {
+        for (int i = 0; i < n; ++i) sum[i] = color[i] + bloom[i];
+    }
+    for (size_t x = 0; x < xs.size(); ++x) {
+        const float *a = sum + 3 * xs[x].i0, *b = sum + 3 * xs[x].i1;
+        for (int k = 0; k < 3; ++k) {
+            out[3 * x + k] = a[k] + (b[k] - a[k]) * xs[x].f;
+        }
+    }
+}
+
+// planes of another size than target, the sum is interpolated before tone mapping as the blur would do
+template<class Op, bool Srgb, typename T>
+void resolveScaled(const T *color, const T *bloom, QSize size, QImage &target)
+{
+    const int width = target.width(), height = target.height();
+    const int n = width * 3, sn = size.width() * 3;
+    const std::vector<Tap> xs = taps(size.width(), width), ys = taps(size.height(), height);
+    uchar *bits = target.bits();
+    const qsizetype stride = target.bytesPerLine();
+
+    std::vector<int> bands((height + bandRows - 1) / bandRows);
+    std::iota(bands.begin(), bands.end(), 0);
+    std::for_each(std::execution::par_unseq, bands.cbegin(), bands.cend(), [&](int band) {
+        // two scaled plane rows, the taps of a target row are neighbours so one is odd and one is even,
+        // rows stay until a target row needs another one of the same parity
+        std::vector<float> rows(2 * n), mixed(n), zero(n), sum(sn), tmp(sn);
+        std::vector<std::int32_t> packed(n);
+        int rowY[2] = {-1, -1};
+        const int y1 = std::min(height, (band + 1) * bandRows);
+        for (int y = band * bandRows; y < y1; ++y) {
+            const Tap &ty = ys[y];
+            for (const int sy : {ty.i0, ty.i1}) {
+                if (rowY[sy & 1] == sy) continue;
+                const qsizetype offset = qsizetype(sy) * sn;
+                scaleRow(color + offset, bloom + offset, size.width(), xs, sum.data(), tmp.data(), rows.data() + (sy & 1) * n);
+                rowY[sy & 1] = sy;
+            }
+            const float *a = rows.data() + (ty.i0 & 1) * n, *b = rows.data() + (ty.i1 & 1) * n;
+            for (int i = 0; i < n; ++i) {
+                mixed[i] = a[i] + (b[i] - a[i]) * ty.f;
+            }
+            resolveRow<Op, Srgb, float>(mixed.data(), zero.data(),
+                                        reinterpret_cast<quint32 *>(bits + y * stride), width, packed.data());
+        }
+    });
+}
+
+template<class Op, typename T>
+void resolveImage(const T *color, const T *bloom, QSize size, QImage &target, bool srgb)
+{
+    if (size != target.size()) {
+        if (srgb) {
+            resolveScaled<Op, true, T>(color, bloom, size, target);
+        } else {
+            resolveScaled<Op, false, T>(color, bloom, size, target);
+        }
+    } else if (srgb) {
+        resolveImage<Op, true, T>(color, bloom, target);
+    } else {
+        resolveImage<Op, false, T>(color, bloom, target);
+    }
+}
+
+template<typename T>
+void resolvePlanes(const T *color, const T *bloom, QSize size, QImage &target, Tonemap::Operator op, bool srgb)
+{
+    switch (op) {
+    case Tonemap::Operator::Reinhard:
+        resolveImage<Tonemap::Reinhard, T>(color, bloom, size, target, srgb);
+        break;
+    case Tonemap::Operator::Aces:
+        resolveImage<Tonemap::Aces, T>(color, bloom, size, target, srgb);
+        break;
+    case Tonemap::Operator::Uncharted2:
+        resolveImage<Tonemap::Uncharted2, T>(color, bloom, size, target, srgb);
+        break;
+    }
+}
+
+} // namespace
+
+void resolve(const float *color, const float *bloom, QSize size, QImage &target, Tonemap::Operator op, bool srgb)
+{
+    resolvePlanes(color, bloom, size, target, op, srgb);
+}
+
+void resolve(const Half *color, const Half *bloom, QSize size, QImage &target, Tonemap::Operator op, bool srgb)
+{
+    resolvePlanes(color, bloom, size, target, op, srgb);
+}
+
+} // namespace Resolve
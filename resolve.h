@@ -0,0 +1,23 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include "half.h"
+#include "tonemap.h"
+
+#include <QImage>
+#include <QSize>
+
+namespace Resolve {
+
+// final pass of a frame: color + bloom, tone mapping, optional srgb encoding,
+// packed straight into the RGB32 rows of target,
+// color and bloom are interleaved rgb float planes of size, bilinearly scaled if target has another size
+void resolve(const float *color, const float *bloom, QSize size, QImage &target,
+             Tonemap::Operator op = Tonemap::Operator::Reinhard, bool srgb = false);
+// same with half precision planes
+void resolve(const Half *color, const Half *bloom, QSize size, QImage &target,
+             Tonemap::Operator op = Tonemap::Operator::Reinhard, bool srgb = false);
+
+} // namespace Resolve
+
+#endif // RESOLVE_H
@@ -0,0 +1,141 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "half.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#endif
+
+namespace Simd {
+
+// packed floats of the widest instruction set enabled at compile time
+// (AVX2 - 8 lanes, SSE2 - 4 lanes, otherwise 1 lane of plain float)
+struct Float
+{
+#if defined(SIMD_AVX2)
+    static constexpr int width = 8;
+    __m256 v;
+#elif defined(SIMD_SSE2)
+    static constexpr int width = 4;
+    __m128 v;
+#else
+    static constexpr int width = 1;
+    float v;
+#endif
+};
+
+#if defined(SIMD_AVX2)
+
+inline Float set1(float a) { return {_mm256_set1_ps(a)}; }
+inline Float load(const float *p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float *p, Float a) { _mm256_storeu_ps(p, a.v); }
+// converts to int32 rounding toward zero
+inline void storeTruncated(std::int32_t *p, Float a) { _mm256_storeu_si256((__m256i *)p, _mm256_cvttps_epi32(a.v)); }
+inline Float ramp() { return {_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)}; }
+#if defined(__F16C__)
+#define SIMD_F16C
+inline Float load(const Half *p) { return {_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)p))}; }
+inline void store(Half *p, Float a) { _mm_storeu_si128((__m128i *)p, _mm256_cvtps_ph(a.v, _MM_FROUND_TO_NEAREST_INT)); }
+#endif
+
+inline Float operator+(Float a, Float b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Float operator/(Float a, Float b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline Float operator|(Float a, Float b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Float max(Float a, Float b) { return {_mm256_max_ps(a.v, b.v)}; }
+
+// bit per lane: sign bit set
+inline int signMask(Float a) { return _mm256_movemask_ps(a.v); }
+// bit per lane: a < b
+inline int lessMask(Float a, Float b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+
+#elif defined(SIMD_SSE2)
+
+inline Float set1(float a) { return {_mm_set1_ps(a)}; }
+inline Float load(const float *p) { return {_mm_loadu_ps(p)}; }
+inline void store(float *p, Float a) { _mm_storeu_ps(p, a.v); }
+inline void storeTruncated(std::int32_t *p, Float a) { _mm_storeu_si128((__m128i *)p, _mm_cvttps_epi32(a.v)); }
+inline Float ramp() { return {_mm_setr_ps(0, 1, 2, 3)}; }
+
+inline Float operator+(Float a, Float b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float operator-(Float a, Float b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float operator*(Float a, Float b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float operator/(Float a, Float b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Float operator|(Float a, Float b) { return {_mm_or_ps(a.v, b.v)}; }
+inline Float min(Float a, Float b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Float max(Float a, Float b) { return {_mm_max_ps(a.v, b.v)}; }
+
+inline int signMask(Float a) { return _mm_movemask_ps(a.v); }
+inline int lessMask(Float a, Float b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+
+#else
+
+inline Float set1(float a) { return {a}; }
+inline Float load(const float *p) { return {*p}; }
+inline void store(float *p, Float a) { *p = a.v; }
+inline void storeTruncated(std::int32_t *p, Float a) { *p = (std::int32_t)a.v; }
+inline Float ramp() { return {0}; }
+
+inline Float operator+(Float a, Float b) { return {a.v + b.v}; }
+inline Float operator-(Float a, Float b) { return {a.v - b.v}; }
+inline Float operator*(Float a, Float b) { return {a.v * b.v}; }
+inline Float operator/(Float a, Float b) { return {a.v / b.v}; }
+inline Float operator|(Float a, Float b)
+{
+    return {std::bit_cast<float>(std::bit_cast<std::uint32_t>(a.v) | std::bit_cast<std::uint32_t>(b.v))};
+}
+inline Float min(Float a, Float b) { return {a.v < b.v ? a.v : b.v}; }
+inline Float max(Float a, Float b) { return {a.v > b.v ? a.v : b.v}; }
+
+inline int signMask(Float a) { return std::signbit(a.v) ? 1 : 0; }
+inline int lessMask(Float a, Float b) { return a.v < b.v ? 1 : 0; }
+
+#endif
+
+#if !defined(SIMD_F16C)
+// half lanes converted one at a time
+inline Float load(const Half *p)
+{
+    float f[Float::width];
+    for (int i = 0; i < Float::width; ++i) f[i] = toFloat(p[i]);
+    return load(f);
+}
+inline void store(Half *p, Float a)
+{
+    float f[Float::width];
+    store(f, a);
+    for (int i = 0; i < Float::width; ++i) p[i] = toHalf(f[i]);
+}
+#endif
+
+// n values of a half plane to float and back, whole registers and a scalar tail
+inline void convert(const Half *src, float *dst, int n)
+{
+    int i = 0;
+    for (; i + Float::width <= n; i += Float::width) store(dst + i, load(src + i));
+    for (; i < n; ++i) dst[i] = toFloat(src[i]);
+}
+inline void convert(const float *src, Half *dst, int n)
+{
+    int i = 0;
+    for (; i + Float::width <= n; i += Float::width) store(dst + i, load(src + i));
+    for (; i < n; ++i) dst[i] = toHalf(src[i]);
+}
+
+// all lanes set
+constexpr int fullMask = (1 << Float::width) - 1;
+
+} // namespace Simd
+
+#endif // SIMD_H
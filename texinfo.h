@@ -1,15 +1,14 @@
 #ifndef TEXINFO_H
 #define TEXINFO_H
 
+#include "texture.h"
 #include "vec3.h"
 
-#include <QImage>
-
 struct TexInfo {
-    QImage tDiffuse;
-    QImage tNormal;
-    QImage tBump;
-    QImage tBloom;
+    Texture tDiffuse;
+    Texture tNormal;
+    Texture tBump;
+    Texture tBloom;
     Math::Vec3 tColor;
 };
 
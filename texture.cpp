@@ -0,0 +1,140 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+Texture::Texture(const QImage &image, Layout layout)
+    : texelLayout(layout)
+{
+    if (image.isNull()) return;
+    const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+    Level base = makeLevel(argb.width(), argb.height(), layout);
+    for (int y = 0; y < base.h; ++y) {
+        const quint32 *line = reinterpret_cast<const quint32 *>(argb.constScanLine(y));
+        if (layout == Layout::RowMajor) {
+            memcpy(base.texels.data() + y * base.w, line, base.w * sizeof(quint32));
+            continue;
+        }
+        for (int x = 0; x < base.w; ++x) base.texel(x, y) = line[x];
+    }
+    levels.append(std::move(base));
+    while (levels.last().w > 1 || levels.last().h > 1) {
+        levels.append(downsample(levels.last(), layout));
+    }
+}
+
+Texture::Level Texture::makeLevel(int w, int h, Layout layout)
+{
+    Level level;
+    level.w = w;
+    level.h = h;
+    level.pow2 = (w & (w - 1)) == 0 && (h & (h - 1)) == 0;
+    level.offsetX.resize(w);
+    level.offsetY.resize(h);
+    if (layout == Layout::Morton && !level.pow2) layout = Layout::Tiled;
+
+    switch (layout) {
+    case Layout::RowMajor:
+        for (int x = 0; x < w; ++x) level.offsetX[x] = x;
+        for (int y = 0; y < h; ++y) level.offsetY[y] = y * w;
+        level.texels.resize(w * h);
+        break;
+    case Layout::Tiled: {
+        constexpr int tile = 8;
+        const int tilesX = (w + tile - 1) / tile, tilesY = (h + tile - 1) / tile;
+        for (int x = 0; x < w; ++x) level.offsetX[x] = (x / tile) * tile * tile + x % tile;
+        for (int y = 0; y < h; ++y) level.offsetY[y] = (y / tile) * tilesX * tile * tile + (y % tile) * tile;
+        level.texels.resize(tilesX * tilesY * tile * tile);
+        break;
+    }
+    case Layout::Morton: {
+        // x bits go to even positions and y bits to odd ones while both have bits,
+        // the rest of the longer side goes on top
+        const int bitsX = std::countr_zero((unsigned)w), bitsY = std::countr_zero((unsigned)h);
+        const int common = std::min(bitsX, bitsY);
+        const auto spread = [common](int v, int bits, int odd) {
+            quint32 r = 0;
+            for (int i = 0; i < bits; ++i) {
+                if (!(v & (1 << i))) continue;
+                r |= i < common ? 1u << (2 * i + odd) : 1u << (common + i);
+            }
+            return r;
+        };
+        for (int x = 0; x < w; ++x) level.offsetX[x] = spread(x, bitsX, 0);
+        for (int y = 0; y < h; ++y) level.offsetY[y] = spread(y, bitsY, 1);
+        level.texels.resize(w * h);
+        break;
+    }
+    }
+    return level;
+}
+
+Texture::Level Texture::downsample(const Level &src, Layout layout)
+{
+    Level dst = makeLevel(std::max(1, src.w / 2), std::max(1, src.h / 2), layout);
+    for (int y = 0; y < dst.h; ++y) {
+        const int y0 = std::min(2 * y, src.h - 1), y1 = std::min(2 * y + 1, src.h - 1);
+        for (int x = 0; x < dst.w; ++x) {
+            const int x0 = std::min(2 * x, src.w - 1), x1 = std::min(2 * x + 1, src.w - 1);
+            const quint32 t[4] = {src.texel(x0, y0), src.texel(x1, y0), src.texel(x0, y1), src.texel(x1, y1)};
+            quint32 out = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                quint32 sum = 2; // round to nearest
+                for (quint32 c : t) sum += (c >> shift) & 0xff;
+                out |= (sum / 4) << shift;
+            }
+            dst.texel(x, y) = out;
+        }
+    }
+    return dst;
+}
+
+Math::Vec3 Texture::sample(float u, float v, float footprint, Filter filter) const
+{
+    // level 0 texels per pixel, lod = log2 of it
+    const float texels = footprint * std::max(levels[0].w, levels[0].h);
+    const float lod = std::clamp(texels > 0.f ? log2f(texels) : 0.f, 0.f, float(levels.size() - 1));
+    switch (filter) {
+    case Filter::Nearest:
+        return sampleNearest(levels[(int)(lod + 0.5f)], u, v);
+    case Filter::Bilinear:
+        return sampleBilinear(levels[(int)(lod + 0.5f)], u, v);
+    case Filter::Trilinear:
+    default:
+        break;
+    }
+    const int l0 = (int)lod, l1 = std::min(l0 + 1, (int)levels.size() - 1);
+    const float t = lod - l0;
+    const Math::Vec3 a = sampleBilinear(levels[l0], u, v);
+    if (t == 0.f || l0 == l1) return a;
+    return a * (1 - t) + sampleBilinear(levels[l1], u, v) * t;
+}
+
+Math::Vec3 Texture::sampleNearest(const Level &level, float u, float v) const
+{
+    const int x = level.wrapX((int)floorf(u * level.w));
+    const int y = level.wrapY((int)floorf((1.f - v) * level.h));
+    return unpack(level.texel(x, y));
+}
+
+Math::Vec3 Texture::sampleBilinear(const Level &level, float u, float v) const
+{
+    // texel centers are at half integers
+    const float fx = u * level.w - 0.5f, fy = (1.f - v) * level.h - 0.5f;
+    const float ix = floorf(fx), iy = floorf(fy);
+    const float tx = fx - ix, ty = fy - iy;
+    const int x0 = level.wrapX((int)ix), x1 = level.wrapX((int)ix + 1);
+    const int y0 = level.wrapY((int)iy), y1 = level.wrapY((int)iy + 1);
+
+    const quint32 t00 = level.texel(x0, y0), t10 = level.texel(x1, y0);
+    const quint32 t01 = level.texel(x0, y1), t11 = level.texel(x1, y1);
+    const float w00 = (1 - tx) * (1 - ty), w10 = tx * (1 - ty), w01 = (1 - tx) * ty, w11 = tx * ty;
+    float c[3];
+    for (int k = 0, shift = 16; k < 3; ++k, shift -= 8) {
+        c[k] = (((t00 >> shift) & 0xff) * w00 + ((t10 >> shift) & 0xff) * w10 +
+                ((t01 >> shift) & 0xff) * w01 + ((t11 >> shift) & 0xff) * w11) * (1.f / 255.f);
+    }
+    return {c[0], c[1], c[2]};
+}
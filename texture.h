@@ -0,0 +1,75 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "vec3.h"
+
+#include <QImage>
+#include <QVector>
+
+// texture decoded once at load time into packed 0xAARRGGBB texels with a full mip chain,
+// sampling wraps around on both axes and v goes up the image like in obj files
+class Texture
+{
+public:
+    // order of texels in memory, swizzled layouts keep 2d neighbours close whatever the uv rotation is
+    enum class Layout {
+        RowMajor,
+        Tiled,      // 8x8 blocks, row-major inside and between blocks
+        Morton,     // z-order curve, power of two sizes only, others fall back to Tiled
+    };
+
+    enum class Filter {
+        Nearest,    // nearest texel of the nearest mip level
+        Bilinear,   // bilinear inside the nearest mip level
+        Trilinear,  // bilinear in the two nearest mip levels, blended
+    };
+
+public:
+    Texture() {}
+    Texture(const QImage &image, Layout layout = Layout::Morton);
+
+public:
+    bool isNull() const {return levels.isEmpty();}
+    int width() const {return isNull() ? 0 : levels[0].w;}
+    int height() const {return isNull() ? 0 : levels[0].h;}
+    int levelCount() const {return levels.size();}
+    Layout layout() const {return texelLayout;}
+
+    // footprint is the uv distance between neighbour pixels, it selects the mip level
+    Math::Vec3 sample(float u, float v, float footprint, Filter filter) const;
+
+private:
+    struct Level {
+        QVector<quint32> texels;
+        // texel (x, y) is at offsetX[x] + offsetY[y], this addresses every layout the same way
+        QVector<quint32> offsetX, offsetY;
+        int w = 0, h = 0;
+        // both sizes are powers of two, wrap with a mask
+        bool pow2 = false;
+
+        int wrapX(int x) const {return pow2 ? x & (w - 1) : (x % w + w) % w;}
+        int wrapY(int y) const {return pow2 ? y & (h - 1) : (y % h + h) % h;}
+        quint32 texel(int x, int y) const {return texels[offsetX[x] + offsetY[y]];}
+        quint32 &texel(int x, int y) {return texels[offsetX[x] + offsetY[y]];}
+    };
+
+    Math::Vec3 sampleNearest(const Level &level, float u, float v) const;
+    Math::Vec3 sampleBilinear(const Level &level, float u, float v) const;
+
+    static Math::Vec3 unpack(quint32 t)
+    {
+        constexpr float k = 1.f / 255.f;
+        return {((t >> 16) & 0xff) * k, ((t >> 8) & 0xff) * k, (t & 0xff) * k};
+    }
+    // empty level of the given size with texel offsets of the layout
+    static Level makeLevel(int w, int h, Layout layout);
+    // 2x2 box filter, odd sizes repeat their last row or column
+    static Level downsample(const Level &src, Layout layout);
+
+private:
+    // level 0 is the full image, every next one is half the size down to 1x1
+    QVector<Level> levels;
+    Layout texelLayout = Layout::RowMajor;
+};
+
+#endif // TEXTURE_H
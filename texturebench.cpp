@@ -0,0 +1,99 @@
+// texture fetch throughput of the texel layouts at several uv rotations
+// usage: texturebench [texture size] [repeats] [texels per pixel]
+
+#include "texture.h"
+
+#include <QImage>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <vector>
+
+namespace {
+
+constexpr int screen = 512;
+// uv step between pixels in texels, level 0 is sampled whatever it is
+float stride = 1;
+
+QImage makeImage(int size)
+{
+    QImage img(size, size, QImage::Format_ARGB32);
+    quint32 seed = 12345;
+    for (int y = 0; y < size; ++y) {
+        quint32 *line = reinterpret_cast<quint32 *>(img.scanLine(y));
+        for (int x = 0; x < size; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            line[x] = 0xff000000u | (seed >> 8);
+        }
+    }
+    return img;
+}
+
+// samples a screen x screen grid of uvs rotated by angle around the texture center,
+// returns nanoseconds per sample of the fastest run
+double run(const Texture &texture, Texture::Filter filter, float angle, int repeats, float &checksum)
+{
+    const float texel = 1.f / texture.width();
+    const float c = cosf(angle) * texel * stride, s = sinf(angle) * texel * stride;
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        float sum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int y = 0; y < screen; ++y) {
+            float u = 0.5f - (screen / 2) * c + (y - screen / 2) * s;
+            float v = 0.5f - (screen / 2) * s - (y - screen / 2) * c;
+            for (int x = 0; x < screen; ++x, u += c, v += s) {
+                sum += texture.sample(u, v, texel, filter).x();
+            }
+        }
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+        checksum += sum;
+    }
+    return best / (screen * screen);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int size = argc > 1 ? atoi(argv[1]) : 2048;
+    const int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    stride = argc > 3 ? atof(argv[3]) : 1;
+    const QImage image = makeImage(size);
+
+    const std::pair<Texture::Layout, const char *> layouts[] = {
+        {Texture::Layout::RowMajor, "row-major"},
+        {Texture::Layout::Tiled, "tiled 8x8"},
+        {Texture::Layout::Morton, "morton"},
+    };
+    const std::pair<Texture::Filter, const char *> filters[] = {
+        {Texture::Filter::Nearest, "nearest"},
+        {Texture::Filter::Bilinear, "bilinear"},
+    };
+    const float angles[] = {0, 15, 30, 45, 60, 90};
+
+    printf("%dx%d texture, %dx%d samples %.1f texels apart, ns per sample\n", size, size, screen, screen, stride);
+    printf("%-10s %-10s", "layout", "filter");
+    for (float a : angles) printf(" %6.0f°", a);
+    printf("\n");
+
+    float checksum = 0;
+    for (const auto &[layout, layoutName] : layouts) {
+        const Texture texture(image, layout);
+        for (const auto &[filter, filterName] : filters) {
+            printf("%-10s %-10s", layoutName, filterName);
+            for (float a : angles) {
+                printf(" %7.2f", run(texture, filter, a * std::numbers::pi_v<float> / 180.f, repeats, checksum));
+            }
+            printf("\n");
+        }
+    }
+    // keeps the sampling from being optimized out
+    fprintf(stderr, "checksum %f\n", checksum);
+    return 0;
+}
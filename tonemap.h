@@ -0,0 +1,93 @@
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+#include "simd.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// tone mapping curves from linear hdr color to [0, 1], one channel per lane,
+// every operator is a type so the resolve kernel is compiled for each of them
+namespace Tonemap {
+
+enum class Operator {
+    Reinhard,
+    Aces,
+    Uncharted2,
+};
+
+// cycles through the operators, a new one is a -Wswitch warning here until it has its place
+constexpr Operator next(Operator op)
+{
+    switch (op) {
+    case Operator::Reinhard: return Operator::Aces;
+    case Operator::Aces: return Operator::Uncharted2;
+    case Operator::Uncharted2: return Operator::Reinhard;
+    }
+    return Operator::Reinhard;
+}
+
+struct Reinhard {
+    static Simd::Float apply(Simd::Float x)
+    {
+        return x / (Simd::set1(1.f) + x);
+    }
+};
+
+// Narkowicz fit of the ACES filmic curve
+struct Aces {
+    static Simd::Float apply(Simd::Float x)
+    {
+        using Simd::set1;
+        const Simd::Float num = x * (set1(2.51f) * x + set1(0.03f));
+        const Simd::Float den = x * (set1(2.43f) * x + set1(0.59f)) + set1(0.14f);
+        return num / den;
+    }
+};
+
+// Hable's filmic curve, white point 11.2
+struct Uncharted2 {
+    static constexpr float A = 0.15f, B = 0.50f, C = 0.10f, D = 0.20f, E = 0.02f, F = 0.30f;
+    static constexpr float exposureBias = 2.f;
+
+    static constexpr float curve(float x)
+    {
+        return (x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F) - E / F;
+    }
+    static Simd::Float curve(Simd::Float x)
+    {
+        using Simd::set1;
+        const Simd::Float num = x * (set1(A) * x + set1(C * B)) + set1(D * E);
+        const Simd::Float den = x * (set1(A) * x + set1(B)) + set1(D * F);
+        return num / den - set1(E / F);
+    }
+    static Simd::Float apply(Simd::Float x)
+    {
+        constexpr float whiteScale = 1.f / curve(11.2f);
+        return curve(x * Simd::set1(exposureBias)) * Simd::set1(whiteScale);
+    }
+};
+
+// sRGB transfer function, [0, 1] quantized to srgbLutBits bits -> 8 bit,
+// a table lookup per channel instead of pow
+constexpr int srgbLutBits = 12;
+constexpr int srgbLutSize = 1 << srgbLutBits;
+
+inline const std::array<std::uint8_t, srgbLutSize> &srgbLut()
+{
+    static const std::array<std::uint8_t, srgbLutSize> lut = [] {
+        std::array<std::uint8_t, srgbLutSize> t;
+        for (int i = 0; i < srgbLutSize; ++i) {
+            const float x = float(i) / (srgbLutSize - 1);
+            const float s = x <= 0.0031308f ? 12.92f * x : 1.055f * std::pow(x, 1.f / 2.4f) - 0.055f;
+            t[i] = std::uint8_t(s * 255.f + 0.5f);
+        }
+        return t;
+    }();
+    return lut;
+}
+
+} // namespace Tonemap
+
+#endif // TONEMAP_H